@@ -2,6 +2,7 @@
 #include <driver/rtc_io.h>
 #include <driver/i2s.h>
 #include <esp_system.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
@@ -10,6 +11,9 @@
 
 #define I2S_NUM (I2S_NUM_0)
 
+// Frames converted and written to I2S per iteration of the audio task
+#define AUDIO_TASK_CHUNK (256)
+
 static int audioSink = ODROID_AUDIO_SINK_SPEAKER;
 static int audioSampleRate = 0;
 static int audioFilter = 0;
@@ -17,6 +21,19 @@ static bool audioMuted = 0;
 static bool audioInitialized = 0;
 static int volumeLevel = ODROID_AUDIO_VOLUME_DEFAULT;
 static float volumeLevels[] = {0.f, 0.06f, 0.125f, 0.187f, 0.25f, 0.35f, 0.42f, 0.60f, 0.80f, 1.f};
+static uint32_t speakerGain = 0; // 254 * volume / 0x8000 in 0.32 fixed point
+
+// Single-producer (emulator) / single-consumer (audio_task) ring of stereo frames.
+// ringHead and ringTail are free running frame counters, only their owner writes them.
+static short *ringBuffer;
+static volatile size_t ringHead = 0;
+static volatile size_t ringTail = 0;
+static SemaphoreHandle_t ringDataSem;
+static SemaphoreHandle_t ringSpaceSem;
+static volatile bool audioTaskRunning = false;
+static volatile bool audioTaskDone = true;
+
+static void audio_task(void *arg);
 
 
 int odroid_audio_volume_get()
@@ -39,6 +56,7 @@ void odroid_audio_volume_set(int level)
 
     odroid_settings_Volume_set(level);
 
+    speakerGain = volumeLevels[level] * 254 * (1 << 17) + 0.5f;
     volumeLevel = level;
 }
 
@@ -106,13 +124,33 @@ void odroid_audio_init(int sample_rate)
 
     odroid_audio_volume_set(volumeLevel);
 
-    printf("%s: I2S init done. clock=%f\n", __func__, i2s_get_clk(I2S_NUM));
+    if (!ringBuffer)
+    {
+        ringBuffer = rg_alloc(ODROID_AUDIO_RING_LENGTH * 2 * sizeof(short), MEM_FAST);
+        ringDataSem = xSemaphoreCreateBinary();
+        ringSpaceSem = xSemaphoreCreateBinary();
+    }
+
+    ringHead = ringTail = 0;
+    audioTaskRunning = true;
+    audioTaskDone = false;
+
+    xTaskCreatePinnedToCore(&audio_task, "audio_task", 2048, NULL, 6, NULL, 1);
+
+    printf("%s: I2S init done. clock=%f ring=%d frames\n", __func__, i2s_get_clk(I2S_NUM),
+        ODROID_AUDIO_RING_LENGTH);
 }
 
 void odroid_audio_terminate()
 {
     if (audioInitialized)
     {
+        audioTaskRunning = false;
+        xSemaphoreGive(ringDataSem);
+        while (!audioTaskDone)
+        {
+            vTaskDelay(1);
+        }
         i2s_zero_dma_buffer(I2S_NUM);
         i2s_driver_uninstall(I2S_NUM);
         audioInitialized = false;
@@ -127,25 +165,49 @@ static inline void filter_samples(short* samples, int count)
 
 }
 
-IRAM_ATTR void odroid_audio_submit(short* stereoAudioBuffer, int frameCount)
+static inline size_t ring_used()
 {
-    size_t sampleCount = frameCount * 2;
-    size_t bufferSize = sampleCount * sizeof(int16_t);
-    size_t written = 0;
-    float volumePercent = volumeLevels[volumeLevel];
+    return __atomic_load_n(&ringHead, __ATOMIC_ACQUIRE) - __atomic_load_n(&ringTail, __ATOMIC_ACQUIRE);
+}
 
-    if (bufferSize == 0)
+// Copies frames between buf and the ring starting at (wrapped) frame index pos
+static inline void ring_copy(short *buf, size_t pos, size_t frames, bool to_ring)
+{
+    size_t start = pos & (ODROID_AUDIO_RING_LENGTH - 1);
+    size_t first = MIN(frames, ODROID_AUDIO_RING_LENGTH - start);
+
+    if (to_ring)
     {
-        printf("%s: Empty buffer?\n", __func__);
-        return;
+        memcpy(ringBuffer + start * 2, buf, first * 4);
+        memcpy(ringBuffer, buf + first * 2, (frames - first) * 4);
     }
-
-    if (audioMuted)
+    else
     {
-        // Simulate i2s_write_bytes delay
-        usleep((audioSampleRate * 1000) / sampleCount);
-        return;
+        memcpy(buf, ringBuffer + start * 2, first * 4);
+        memcpy(buf + first * 2, ringBuffer, (frames - first) * 4);
     }
+}
+
+// Integer equivalent of range = 254 * (sample / 0x8000) * volume followed by the
+// differential split: dac0 takes [-127, 127] and dac1 the overflow, if any.
+static inline void speaker_convert(int32_t sample, short *out)
+{
+    // Scale the magnitude so the truncation goes toward zero, like the float cast did
+    uint32_t magnitude = ((uint64_t)(uint32_t)abs(sample) * speakerGain) >> 32;
+    int32_t range = sample < 0 ? -(int32_t)magnitude : (int32_t)magnitude;
+
+    // Convert to differential output
+    int32_t dac0 = MIN(MAX(range, -127), 127);
+    int32_t dac1 = range - dac0;
+
+    out[0] = (short)((0x80 - dac1) << 8);
+    out[1] = (short)((dac0 + 0x80) << 8);
+}
+
+static inline void convert_samples(short* stereoAudioBuffer, size_t sampleCount)
+{
+    size_t bufferSize = sampleCount * sizeof(int16_t);
+    float volumePercent = volumeLevels[volumeLevel];
 
     if (volumePercent == 0.0f)
     {
@@ -154,45 +216,22 @@ IRAM_ATTR void odroid_audio_submit(short* stereoAudioBuffer, int frameCount)
     }
     else if (audioSink == ODROID_AUDIO_SINK_SPEAKER)
     {
-        for (short i = 0; i < sampleCount; i += 2)
+        size_t i = 0;
+
+        for (; i + 4 <= sampleCount; i += 4)
         {
             // Down mix stero to mono
-            int32_t sample = (stereoAudioBuffer[i] + stereoAudioBuffer[i + 1]) >> 1;
-
-            // Normalize
-            const float sn = (float)sample / 0x8000;
-
-            // Scale
-            const int magnitude = 127 + 127;
-            const float range = magnitude * sn * volumePercent;
-
-            uint16_t dac0, dac1;
-
-            // Convert to differential output
-            if (range > 127.f)
-            {
-                dac1 = (range - 127);
-                dac0 = 127;
-            }
-            else if (range < -127.f)
-            {
-                dac1 = (range + 127);
-                dac0 = -127;
-            }
-            else
-            {
-                dac1 = 0;
-                dac0 = range;
-            }
+            int32_t sample0 = (stereoAudioBuffer[i + 0] + stereoAudioBuffer[i + 1]) >> 1;
+            int32_t sample1 = (stereoAudioBuffer[i + 2] + stereoAudioBuffer[i + 3]) >> 1;
 
-            dac0 += 0x80;
-            dac1 = 0x80 - dac1;
-
-            dac0 <<= 8;
-            dac1 <<= 8;
+            speaker_convert(sample0, &stereoAudioBuffer[i + 0]);
+            speaker_convert(sample1, &stereoAudioBuffer[i + 2]);
+        }
 
-            stereoAudioBuffer[i] = (short)dac1;
-            stereoAudioBuffer[i + 1] = (short)dac0;
+        if (i < sampleCount)
+        {
+            int32_t sample = (stereoAudioBuffer[i] + stereoAudioBuffer[i + 1]) >> 1;
+            speaker_convert(sample, &stereoAudioBuffer[i]);
         }
     }
     else if (audioSink == ODROID_AUDIO_SINK_DAC)
@@ -219,12 +258,86 @@ IRAM_ATTR void odroid_audio_submit(short* stereoAudioBuffer, int frameCount)
     {
         filter_samples(stereoAudioBuffer, bufferSize);
     }
+}
+
+static void audio_task(void *arg)
+{
+    // The consumer owns the conversion so that the emulation thread only copies samples
+    static short buffer[AUDIO_TASK_CHUNK * 2];
 
-    i2s_write(I2S_NUM, (const short *)stereoAudioBuffer, bufferSize, &written, 1000);
-    if (written == 0) // Anything > 0 is fine
+    while (audioTaskRunning)
     {
-        printf("odroid_audio_submit: i2s_write failed.\n");
-        abort();
+        size_t available = ring_used();
+
+        if (available == 0)
+        {
+            xSemaphoreTake(ringDataSem, pdMS_TO_TICKS(100));
+            continue;
+        }
+
+        size_t frames = MIN(available, (size_t)AUDIO_TASK_CHUNK);
+        size_t tail = ringTail;
+
+        ring_copy(buffer, tail, frames, false);
+
+        __atomic_store_n(&ringTail, tail + frames, __ATOMIC_RELEASE);
+        xSemaphoreGive(ringSpaceSem);
+
+        convert_samples(buffer, frames * 2);
+
+        size_t written = 0;
+        i2s_write(I2S_NUM, (const short *)buffer, frames * 4, &written, 1000);
+        if (written == 0) // Anything > 0 is fine
+        {
+            printf("%s: i2s_write failed.\n", __func__);
+        }
+    }
+
+    audioTaskDone = true;
+    vTaskDelete(NULL);
+}
+
+IRAM_ATTR void odroid_audio_submit(short* stereoAudioBuffer, int frameCount)
+{
+    size_t sampleCount = frameCount * 2;
+
+    if (sampleCount == 0)
+    {
+        printf("%s: Empty buffer?\n", __func__);
+        return;
+    }
+
+    if (audioMuted || !audioTaskRunning)
+    {
+        // Simulate i2s_write_bytes delay
+        usleep((audioSampleRate * 1000) / sampleCount);
+        return;
+    }
+
+    // Single producer: only the emulation thread moves ringHead. When the ring is full we
+    // block until the audio task frees some space, this is what throttles the emulation.
+    for (size_t pos = 0; pos < frameCount;)
+    {
+        size_t space = ODROID_AUDIO_RING_LENGTH - ring_used();
+
+        if (space == 0)
+        {
+            if (xSemaphoreTake(ringSpaceSem, pdMS_TO_TICKS(1000)) != pdTRUE)
+            {
+                printf("%s: audio task stalled, dropping %d frames.\n", __func__, (int)(frameCount - pos));
+                return;
+            }
+            continue;
+        }
+
+        size_t count = MIN(space, frameCount - pos);
+        size_t head = ringHead;
+
+        ring_copy(stereoAudioBuffer + pos * 2, head, count, true);
+
+        __atomic_store_n(&ringHead, head + count, __ATOMIC_RELEASE);
+        xSemaphoreGive(ringDataSem);
+        pos += count;
     }
 }
 
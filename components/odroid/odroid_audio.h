@@ -20,6 +20,12 @@ typedef enum
 #define ODROID_AUDIO_VOLUME_MAX 9 // (sizeof(volumeLevels) / sizeof(float) - 1)
 #define ODROID_AUDIO_VOLUME_DEFAULT (ODROID_AUDIO_VOLUME_MAX/3)
 
+// Depth of the submit ring in stereo frames, must be a power of two.
+// Can be overridden per app (CPPFLAGS += -DODROID_AUDIO_RING_LENGTH=...)
+#ifndef ODROID_AUDIO_RING_LENGTH
+#define ODROID_AUDIO_RING_LENGTH 1024
+#endif
+
 int odroid_audio_volume_get();
 void odroid_audio_volume_set(int levwl);
 void odroid_audio_init(int sample_rate);
@@ -30,7 +30,29 @@ static SemaphoreHandle_t spi_count_semaphore;
 static spi_transaction_t trans[SPI_TRANSACTION_COUNT];
 static spi_device_handle_t spi;
 
+// Frames are diffed by the producer then handed to display_task, which owns them
+// until they're on the screen.
+#define DISPLAY_MAX_DROPPED_FRAMES 2
+
+typedef struct {
+    odroid_video_frame *frame;
+    bool refresh;
+    uint queueTime;
+} video_update_t;
+
 static QueueHandle_t videoTaskQueue;
+static odroid_video_frame *lastFrame = NULL;
+
+static struct {
+    uint queued;
+    uint dropped;
+    uint busy;
+    uint latencyTotal;
+    uint latencyMax;
+    uint latencyCount;
+    uint clearTotal;
+    uint clearCount;
+} videoStats;
 
 static int8_t backlightLevels[] = {10, 25, 50, 75, 100};
 
@@ -537,7 +559,7 @@ bilinear_filter(uint16_t *line_buffer, short top, short left, short width, short
 
 static inline void
 write_rect(void *buffer, uint16_t *palette, short left, short top, short width, short height,
-           short stride, short pixel_size, uint8_t pixel_mask, short pixel_clear)
+           short stride, short pixel_size, uint8_t pixel_mask)
 {
     short scaled_left = ((SCREEN_WIDTH * left) + (x_inc - 1)) / x_inc;
     short scaled_top = ((SCREEN_HEIGHT * top) + (y_inc - 1)) / y_inc;
@@ -613,11 +635,6 @@ write_rect(void *buffer, uint16_t *palette, short left, short top, short width,
                 }
             }
 
-            if (pixel_clear > -1) {
-                // if (pixel_clear > -1) ((uint16_t*)buffer)[x] = pixel_clear;
-                memset((uint8_t*)buffer, pixel_clear, width);
-            }
-
             if (!screen_line_is_empty[++screen_y]) {
                 buffer += stride;
                 ++y;
@@ -636,24 +653,20 @@ write_rect(void *buffer, uint16_t *palette, short left, short top, short width,
 }
 
 static inline bool
-pixel_diff(uint8_t pixel1, uint8_t pixel2, uint16_t *palette1, uint16_t *palette2,
-           uint8_t pixel_mask, uint8_t palette_shift_mask)
+pixel_dirty(uint8_t pixel, uint32_t *pal_dirty, uint8_t pixel_mask, uint8_t palette_shift_mask)
 {
-    uint8_t p1 = pixel1 & pixel_mask;
-    uint8_t p2 = pixel2 & pixel_mask;
+    uint8_t p = pixel & pixel_mask;
 
-    if (palette_shift_mask) {
-        if (pixel1 & palette_shift_mask) p1 += (pixel_mask + 1);
-        if (pixel2 & palette_shift_mask) p2 += (pixel_mask + 1);
-    }
+    if (pixel & palette_shift_mask) p += (pixel_mask + 1);
 
-    return palette1[p1] != palette2[p2];
+    return pal_dirty[p >> 5] & (1u << (p & 31));
 }
 
 static inline int
 frame_diff(odroid_video_frame *frame, odroid_video_frame *prevFrame)
 {
     uint8_t pixel_mask = frame->pixel_mask;
+    uint8_t index_mask = frame->pixel_mask | frame->pal_shift_mask;
     odroid_line_diff *out_diff = frame->diff;
     bool use_u32bit = false;
 
@@ -663,12 +676,15 @@ frame_diff(odroid_video_frame *frame, odroid_video_frame *prevFrame)
         pixel_mask = 0xFF;
         use_u32bit = true;
     }
-    // If the palette didn't change we can speed up things by avoiding pixel_diff()
-    else if (frame->palette == prevFrame->palette
-         || memcmp(frame->palette, prevFrame->palette, (pixel_mask + 1) * 2) == 0)
+    // If no palette entry changed only the pixel values need to be compared
+    else
     {
-        pixel_mask |= frame->pal_shift_mask;
         use_u32bit = true;
+        for (short i = 0; i < 8; ++i)
+        {
+            if (frame->pal_dirty[i]) use_u32bit = false;
+        }
+        pixel_mask = index_mask;
     }
 
     int lines_changed = 0;
@@ -708,18 +724,19 @@ frame_diff(odroid_video_frame *frame, odroid_video_frame *prevFrame)
         } else {
             uint8_t *buffer8 = frame->buffer + i;
             uint8_t *old_buffer8 = prevFrame->buffer + i;
+            // A pixel changed if its index did or if it uses a changed entry
             for (short x = 0; x < frame->width; ++x)
             {
-                if (!pixel_diff(buffer8[x], old_buffer8[x], frame->palette, prevFrame->palette,
-                                frame->pixel_mask, frame->pal_shift_mask)) {
+                if (!((buffer8[x] ^ old_buffer8[x]) & index_mask)
+                    && !pixel_dirty(buffer8[x], frame->pal_dirty, frame->pixel_mask, frame->pal_shift_mask)) {
                     continue;
                 }
                 out_diff[y].left = x;
 
                 for (x = frame->width - 1; x >= 0; --x)
                 {
-                    if (!pixel_diff(buffer8[x], old_buffer8[x], frame->palette, prevFrame->palette,
-                                    frame->pixel_mask, frame->pal_shift_mask)) {
+                    if (!((buffer8[x] ^ old_buffer8[x]) & index_mask)
+                        && !pixel_dirty(buffer8[x], frame->pal_dirty, frame->pixel_mask, frame->pal_shift_mask)) {
                         continue;
                     }
                     out_diff[y].width = (x - out_diff[y].left) + 1;
@@ -846,47 +863,120 @@ generate_filter_structures(short width, short height)
     frame_filter_lines[0].start = frame_filter_lines[height-1].stop  = true;
 }
 
+static short
+display_diff(odroid_video_frame *frame, odroid_video_frame *previousFrame)
+{
+    static int prev_width = 0, prev_height = 0;
+    short linesChanged;
+
+    if (frame->width != prev_width || frame->height != prev_height)
+    {
+        prev_width = frame->width;
+        prev_height = frame->height;
+        forceVideoRefresh = true;
+    }
+
+    if (previousFrame && !forceVideoRefresh)
+    {
+        linesChanged = frame_diff(frame, previousFrame);
+    }
+    else
+    {
+        frame->diff[0].left = 0;
+        frame->diff[0].width = frame->width;
+        frame->diff[0].repeat = frame->height;
+        linesChanged = frame->height;
+    }
+
+    if (linesChanged == frame->height)
+        return SCREEN_UPDATE_FULL;
+
+    if (linesChanged == 0)
+        return SCREEN_UPDATE_EMPTY;
+
+    return SCREEN_UPDATE_PARTIAL;
+}
+
+static inline void
+clear_frame(odroid_video_frame *frame)
+{
+    short line_size = frame->width * frame->pixel_size;
+
+    // memset works a word at a time, so contiguous frames are done in one call
+    if (frame->stride == line_size)
+    {
+        memset(frame->buffer, frame->pixel_clear, line_size * frame->height);
+        return;
+    }
+
+    for (short y = 0; y < frame->height; ++y)
+    {
+        memset(frame->buffer + y * frame->stride, frame->pixel_clear, line_size);
+    }
+}
+
 IRAM_ATTR static void
 display_task(void *arg)
 {
-    videoTaskQueue = xQueueCreate(1, sizeof(void*));
-
-    odroid_video_frame *update;
+    video_update_t update;
 
     while(1)
     {
         xQueuePeek(videoTaskQueue, &update, portMAX_DELAY);
 
-        if (!update) break;
+        if (!update.frame) break;
 
-        if (forceVideoRefresh)
+        odroid_video_frame *frame = update.frame;
+
+        if (update.refresh)
         {
             if (scalingMode == ODROID_DISPLAY_SCALING_FILL) {
-                odroid_display_set_scale(update->width, update->height, SCREEN_WIDTH / (double)SCREEN_HEIGHT);
+                odroid_display_set_scale(frame->width, frame->height, SCREEN_WIDTH / (double)SCREEN_HEIGHT);
             }
             else if (scalingMode == ODROID_DISPLAY_SCALING_FIT) {
-                odroid_display_set_scale(update->width, update->height, update->width / (double)update->height);
+                odroid_display_set_scale(frame->width, frame->height, frame->width / (double)frame->height);
             }
             else {
-                odroid_display_set_scale(update->width, update->height, 0.0);
+                odroid_display_set_scale(frame->width, frame->height, 0.0);
             }
             odroid_display_clear(C_BLACK);
+
+            // The refresh may have been requested after the diff
+            frame->diff[0].left = 0;
+            frame->diff[0].width = frame->width;
+            frame->diff[0].repeat = frame->height;
         }
 
-        for (short y = 0; y < update->height;)
+        for (short y = 0; y < frame->height;)
         {
-            odroid_line_diff *diff = &update->diff[y];
+            odroid_line_diff *diff = &frame->diff[y];
 
             if (diff->width > 0) {
-                write_rect(update->buffer + (y * update->stride) + (diff->left * update->pixel_size),
-                           update->palette, diff->left, y, diff->width, diff->repeat, update->stride,
-                           update->pixel_size, update->pixel_mask, update->pixel_clear);
+                write_rect(frame->buffer + (y * frame->stride) + (diff->left * frame->pixel_size),
+                           frame->palette, diff->left, y, diff->width, diff->repeat, frame->stride,
+                           frame->pixel_size, frame->pixel_mask);
             }
             y += diff->repeat;
         }
 
-        forceVideoRefresh = false;
+        odroid_overlay_draw_notice();
 
+        uint latency = get_elapsed_time_since(update.queueTime);
+        videoStats.latencyTotal += latency;
+        videoStats.latencyMax = MAX(videoStats.latencyMax, latency);
+        videoStats.latencyCount++;
+
+        // The frame is cleared in one pass once it's on the screen, while the
+        // producer is still busy with its other buffer
+        if (frame->pixel_clear > -1)
+        {
+            uint clearStart = get_elapsed_time();
+            clear_frame(frame);
+            videoStats.clearTotal += get_elapsed_time_since(clearStart);
+            videoStats.clearCount++;
+        }
+
+        // Hand the frame back to the producer
         xQueueReceive(videoTaskQueue, &update, portMAX_DELAY);
     }
 
@@ -984,45 +1074,108 @@ void odroid_display_force_refresh(void)
     forceVideoRefresh = true;
 }
 
-IRAM_ATTR short odroid_display_update(odroid_video_frame *frame, odroid_video_frame *previousFrame)
+bool odroid_display_get_thumbnail(uint16_t *buffer, short width, short height)
 {
-    static int prev_width = 0, prev_height = 0;
-    short linesChanged = 0;
+    odroid_video_frame *frame = lastFrame;
 
-    if (frame)
+    // Frames cleared after display don't hold a picture anymore
+    if (!frame || frame->pixel_clear > -1)
     {
-        if (frame->width != prev_width || frame->height != prev_height)
-        {
-            prev_width = frame->width;
-            prev_height = frame->height;
-            forceVideoRefresh = true;
-        }
+        return false;
+    }
 
-        if (previousFrame && !forceVideoRefresh)
-        {
-            linesChanged = frame_diff(frame, previousFrame);
-        }
-        else
+    for (short y = 0; y < height; ++y)
+    {
+        uint8_t *line = frame->buffer + (y * frame->height / height) * frame->stride;
+
+        for (short x = 0; x < width; ++x)
         {
-            frame->diff[0].left = 0;
-            frame->diff[0].width = frame->width;
-            frame->diff[0].repeat = frame->height;
-            linesChanged = frame->height;
+            short src_x = x * frame->width / width;
+            uint16_t pixel;
+
+            if (frame->palette == NULL) {
+                pixel = ((uint16_t*)line)[src_x];
+            } else {
+                pixel = ((uint16_t*)frame->palette)[line[src_x] & frame->pixel_mask];
+            }
+
+            // Frames are big endian, ready for the LCD
+            buffer[y * width + x] = pixel << 8 | pixel >> 8;
         }
     }
 
-    // if (linesChanged > 0)
+    return true;
+}
+
+void odroid_palette_latch(odroid_palette_t *palette, odroid_video_frame *frame, short count)
+{
+    if (frame->palette != palette->colors)
     {
-        xQueueSend(videoTaskQueue, &frame, portMAX_DELAY);
+        memcpy(frame->palette, palette->colors, count * 2);
     }
 
-    if (linesChanged == frame->height)
-        return SCREEN_UPDATE_FULL;
+    // A dropped frame keeps its dirty entries until it's finally queued
+    for (short i = 0; i < 8; ++i)
+    {
+        frame->pal_dirty[i] |= palette->dirty[i];
+        palette->dirty[i] = 0;
+    }
+}
 
-    if (linesChanged == 0)
-        return SCREEN_UPDATE_EMPTY;
+IRAM_ATTR short odroid_display_queue_update(odroid_video_frame *frame, odroid_video_frame *previousFrame)
+{
+    static uint droppedFrames = 0;
 
-    return SCREEN_UPDATE_PARTIAL;
+    if (!frame)
+        return SCREEN_UPDATE_ERROR;
+
+    // The emulated frame is complete even if it never makes it to the screen
+    odroid_movie_frame(frame);
+
+    bool busy = uxQueueMessagesWaiting(videoTaskQueue) > 0;
+
+    if (busy)
+    {
+        videoStats.busy++;
+
+        // Only diffed frames are dropped, their buffer is simply drawn over by the next frame.
+        // Full refreshes (no previous frame, cleared frames) must always reach the screen.
+        if (previousFrame && frame->pixel_clear < 0 && !forceVideoRefresh
+            && droppedFrames < DISPLAY_MAX_DROPPED_FRAMES)
+        {
+            droppedFrames++;
+            videoStats.dropped++;
+            return SCREEN_UPDATE_DROPPED;
+        }
+    }
+
+    // The diff runs while display_task is still sending the previous frame
+    short result = display_diff(frame, previousFrame);
+
+    // The next frame is compared against this one
+    memset(frame->pal_dirty, 0, sizeof(frame->pal_dirty));
+
+    video_update_t update = {frame, forceVideoRefresh, get_elapsed_time()};
+
+    forceVideoRefresh = false;
+    droppedFrames = 0;
+    videoStats.queued++;
+    lastFrame = frame;
+
+    xQueueSend(videoTaskQueue, &update, portMAX_DELAY);
+
+    return result;
+}
+
+void odroid_display_get_stats(odroid_display_stats_t *out)
+{
+    out->queued = videoStats.queued;
+    out->dropped = videoStats.dropped;
+    out->busy = videoStats.busy;
+    out->latency = videoStats.latencyCount ? videoStats.latencyTotal / videoStats.latencyCount : 0;
+    out->latencyMax = videoStats.latencyMax;
+    out->clearTime = videoStats.clearCount ? videoStats.clearTotal / videoStats.clearCount : 0;
+    memset(&videoStats, 0, sizeof(videoStats));
 }
 
 void odroid_display_drain_spi()
@@ -1128,6 +1281,7 @@ void odroid_display_init()
     backlight_init();
 
 	printf("     - starting display_task.\n");
+    videoTaskQueue = xQueueCreate(1, sizeof(video_update_t));
     xTaskCreatePinnedToCore(&display_task, "display_task", 4096, NULL, 5, NULL, 1);
 
     printf("     - done.\n");
@@ -11,6 +11,7 @@ typedef enum {
     SCREEN_UPDATE_FULL,
     SCREEN_UPDATE_PARTIAL,
     SCREEN_UPDATE_ERROR,
+    SCREEN_UPDATE_DROPPED, // The display was busy, the frame buffer still belongs to the caller
 } screen_update_t;
 
 typedef enum
@@ -68,13 +69,28 @@ typedef struct {
     int stride;         // In bytes
     int pixel_size;     // In bytes
     int pixel_mask;     // Unused if no palette
-    int pixel_clear;    // Clear each pixel to this value after reading it (-1 to disable)
+    int pixel_clear;    // Clear the frame to this byte value once it's displayed (-1 to disable)
     void *buffer;       // Should be at least height*stride bytes
     void *palette;      //
     uint8_t pal_shift_mask;
+    uint32_t pal_dirty[8]; // Palette entries changed since the previous frame, see odroid_palette_latch
     odroid_line_diff diff[256];
 } odroid_video_frame;
 
+typedef struct {
+    uint16_t colors[256]; // Big endian RGB565, ready for the LCD
+    uint32_t dirty[8];    // One bit per entry changed since the last latch
+} odroid_palette_t;
+
+typedef struct {
+    uint32_t queued;     // Frames handed to the display task
+    uint32_t dropped;    // Frames dropped because the display task was still busy
+    uint32_t busy;       // Frames that found the display task busy (dropped or waited)
+    uint32_t latency;    // Average time from queueing to the end of the transfer, in us
+    uint32_t latencyMax; // Worst of the above
+    uint32_t clearTime;  // Average time spent clearing frames after their transfer, in us
+} odroid_display_stats_t;
+
 void odroid_display_init();
 void odroid_display_deinit();
 void odroid_display_drain_spi();
@@ -83,9 +99,10 @@ void odroid_display_write_rect(short left, short top, short width, short height,
 void odroid_display_clear(uint16_t colorLE);
 void odroid_display_show_hourglass();
 void odroid_display_force_refresh(void);
+bool odroid_display_get_thumbnail(uint16_t *buffer, short width, short height);
 void odroid_display_set_scale(short width, short height, double aspect_ratio);
-short odroid_display_update(odroid_video_frame *frame, odroid_video_frame *previousFrame);
-#define odroid_display_queue_update(x...) odroid_display_update(x)
+short odroid_display_queue_update(odroid_video_frame *frame, odroid_video_frame *previousFrame);
+void odroid_display_get_stats(odroid_display_stats_t *out);
 
 odroid_display_backlight_t odroid_display_get_backlight();
 void odroid_display_set_backlight(odroid_display_backlight_t level);
@@ -98,3 +115,19 @@ void odroid_display_set_filter_mode(odroid_display_filter_t mode);
 
 odroid_display_rotation_t odroid_display_get_rotation(void);
 void odroid_display_set_rotation(odroid_display_rotation_t rotation);
+
+// Copies count entries to frame->palette (unless it's the same table) and hands
+// the dirty entries over to the frame, to be called right before queueing it
+void odroid_palette_latch(odroid_palette_t *palette, odroid_video_frame *frame, short count);
+
+// Only entries that actually change are converted and marked dirty
+static inline void odroid_palette_set(odroid_palette_t *palette, uint8_t index, uint16_t color)
+{
+    color = (color >> 8) | (color << 8);
+
+    if (palette->colors[index] != color)
+    {
+        palette->colors[index] = color;
+        palette->dirty[index >> 5] |= 1u << (index & 31);
+    }
+}
@@ -1,4 +1,6 @@
 #include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <esp_timer.h>
 #include <driver/i2c.h>
 #include <driver/gpio.h>
 #include <driver/adc.h>
@@ -13,10 +15,31 @@
 #define BATT_DIVIDER_R1          (10000)
 #define BATT_DIVIDER_R2          (10000)
 
+// The FreeRTOS tick is 10ms, so the sampler is woken up by an esp_timer instead
+#define INPUT_SAMPLE_PERIOD      (1000) // us
+#define INPUT_QUEUE_SIZE         (32)
+// A change is accepted on the first sample, then the button is ignored while it bounces
+#define INPUT_DEBOUNCE_LOCKOUT   (10) // samples
+
+typedef struct
+{
+    uint time;
+    uint16_t bitmask;
+} input_edge_t;
+
 static volatile bool input_task_is_running = false;
 static volatile uint last_gamepad_read = 0;
 static odroid_gamepad_state gamepad_state;
 static SemaphoreHandle_t xSemaphore;
+static TaskHandle_t input_task_handle;
+static esp_timer_handle_t input_timer;
+
+// Debounced state changes since the last latch
+static input_edge_t edge_queue[INPUT_QUEUE_SIZE];
+static uint edge_head, edge_tail;
+
+// Time between a change and the latch that picked it up
+static uint latency_total, latency_count, latency_max;
 
 odroid_gamepad_state odroid_input_gamepad_read_raw()
 {
@@ -48,25 +71,25 @@ odroid_gamepad_state odroid_input_gamepad_read_raw()
     return state;
 }
 
+static void input_timer_callback(void *arg)
+{
+    xTaskNotifyGive(input_task_handle);
+}
+
 static void input_task(void *arg)
 {
     input_task_is_running = true;
 
-    uint8_t debounce[ODROID_INPUT_MAX];
+    uint8_t lockout[ODROID_INPUT_MAX];
 
     // Initialize debounce state
-    memset(debounce, 0xFF, ODROID_INPUT_MAX);
+    memset(lockout, 0, sizeof(lockout));
 
     while (input_task_is_running)
     {
         // Read hardware
         odroid_gamepad_state state = odroid_input_gamepad_read_raw();
-
-        for(int i = 0; i < ODROID_INPUT_MAX; ++i)
-		{
-            // Shift current values
-			debounce[i] <<= 1;
-		}
+        uint16_t previous = gamepad_state.bitmask;
 
         // Debounce
         xSemaphoreTake(xSemaphore, portMAX_DELAY);
@@ -75,29 +98,38 @@ static void input_task(void *arg)
 
         for(int i = 0; i < ODROID_INPUT_MAX; ++i)
 		{
-            debounce[i] |= state.values[i] ? 1 : 0;
-            uint8_t val = debounce[i] & 0x03; //0x0f;
-            switch (val) {
-                case 0x00:
-                    gamepad_state.values[i] = 0;
-                    break;
-
-                case 0x03: //0x0f:
-                    gamepad_state.values[i] = 1;
-                    gamepad_state.bitmask |= 1 << i;
-                    break;
-
-                default:
-                    // ignore
-                    break;
+            if (lockout[i] > 0)
+            {
+                // ignore, keep the previous value
+                lockout[i]--;
             }
+            else if (state.values[i] != gamepad_state.values[i])
+            {
+                gamepad_state.values[i] = state.values[i];
+                lockout[i] = INPUT_DEBOUNCE_LOCKOUT;
+            }
+
+            gamepad_state.bitmask |= gamepad_state.values[i] << i;
 		}
 
+        if (gamepad_state.bitmask != previous)
+        {
+            // Drop the oldest change if nobody is latching
+            if (edge_head - edge_tail == INPUT_QUEUE_SIZE)
+                edge_tail++;
+
+            input_edge_t *edge = &edge_queue[edge_head++ % INPUT_QUEUE_SIZE];
+            edge->time = get_elapsed_time();
+            edge->bitmask = gamepad_state.bitmask;
+        }
+
         xSemaphoreGive(xSemaphore);
 
-        vTaskDelay(pdMS_TO_TICKS(10));
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
     }
 
+    esp_timer_stop(input_timer);
+    esp_timer_delete(input_timer);
     vSemaphoreDelete(xSemaphore);
     vTaskDelete(NULL);
 }
@@ -129,7 +161,14 @@ void odroid_input_gamepad_init()
 	gpio_set_direction(ODROID_PIN_GAMEPAD_VOLUME, GPIO_MODE_INPUT);
 
     // Start background polling
-    xTaskCreatePinnedToCore(&input_task, "input_task", 2048, NULL, 5, NULL, 1);
+    xTaskCreatePinnedToCore(&input_task, "input_task", 2048, NULL, 5, &input_task_handle, 1);
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = &input_timer_callback,
+        .name = "input_timer",
+    };
+    esp_timer_create(&timer_args, &input_timer);
+    esp_timer_start_periodic(input_timer, INPUT_SAMPLE_PERIOD);
 
   	printf("odroid_input_gamepad_init done.\n");
 }
@@ -158,6 +197,60 @@ void odroid_input_gamepad_read(odroid_gamepad_state* out_state)
     last_gamepad_read = get_elapsed_time();
 }
 
+// Like odroid_input_gamepad_read but meant to be called once per frame at the
+// emulator's input poll point. Buttons that were pressed and released since the
+// previous latch are reported as pressed, so short taps aren't lost.
+void odroid_input_gamepad_latch(odroid_gamepad_state* out_state)
+{
+    assert(input_task_is_running == true);
+
+    xSemaphoreTake(xSemaphore, portMAX_DELAY);
+
+    uint now = get_elapsed_time();
+    uint16_t bitmask = gamepad_state.bitmask;
+
+    for (; edge_tail != edge_head; edge_tail++)
+    {
+        input_edge_t *edge = &edge_queue[edge_tail % INPUT_QUEUE_SIZE];
+        uint latency = now - edge->time;
+
+        bitmask |= edge->bitmask;
+        latency_total += latency;
+        latency_max = MAX(latency_max, latency);
+        latency_count++;
+    }
+
+    xSemaphoreGive(xSemaphore);
+
+    for (int i = 0; i < ODROID_INPUT_MAX; ++i)
+        out_state->values[i] = (bitmask >> i) & 1;
+    out_state->bitmask = bitmask;
+
+    // Record or replace the frame's input if a movie is running
+    odroid_movie_input(out_state);
+
+    last_gamepad_read = now;
+}
+
+// Forget the changes that weren't latched yet, for code that polls with
+// odroid_input_gamepad_read() (dialogs) and doesn't want them to reach the game
+void odroid_input_flush(void)
+{
+    xSemaphoreTake(xSemaphore, portMAX_DELAY);
+    edge_tail = edge_head;
+    xSemaphoreGive(xSemaphore);
+}
+
+// Average and worst latency in us since the previous call
+void odroid_input_get_latency(uint32_t *average, uint32_t *worst)
+{
+    xSemaphoreTake(xSemaphore, portMAX_DELAY);
+    *average = latency_count ? latency_total / latency_count : 0;
+    *worst = latency_max;
+    latency_total = latency_count = latency_max = 0;
+    xSemaphoreGive(xSemaphore);
+}
+
 bool odroid_input_key_is_pressed(int key)
 {
     odroid_gamepad_state joystick;
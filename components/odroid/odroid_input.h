@@ -38,6 +38,9 @@ void odroid_input_gamepad_init();
 void odroid_input_gamepad_terminate();
 long odroid_input_gamepad_last_polled();
 void odroid_input_gamepad_read(odroid_gamepad_state* out_state);
+void odroid_input_gamepad_latch(odroid_gamepad_state* out_state);
+void odroid_input_flush(void);
+void odroid_input_get_latency(uint32_t *average, uint32_t *worst);
 bool odroid_input_key_is_pressed(int key);
 void odroid_input_wait_for_key(int key, bool pressed);
 
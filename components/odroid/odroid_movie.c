@@ -0,0 +1,367 @@
+#include <freertos/FreeRTOS.h>
+#include <rom/crc.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "odroid_system.h"
+#include "odroid_movie.h"
+
+// A movie is a header followed by the input changes and the checkpoints:
+//  - input: varint frames since the previous change, then the 16bit bitmask
+//  - checkpoint: 32bit frame number, then the 32bit crc of the drawn frame
+// The start state is the save slot recorded in the header.
+#define MOVIE_MAGIC   0x564D4752 // "RGMV"
+#define MOVIE_VERSION 1
+
+// Those buttons drive the system, not the game
+#define MOVIE_IGNORED_KEYS ((1 << ODROID_INPUT_MENU) | (1 << ODROID_INPUT_VOLUME))
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t slot;
+    uint32_t appId;
+    uint32_t gameId;
+    uint32_t frames;
+    uint32_t inputSize;
+    uint32_t checkpoints;
+} movie_header_t;
+
+typedef struct {
+    uint32_t frame;
+    uint32_t crc;
+} movie_checkpoint_t;
+
+static odroid_movie_mode_t mode = ODROID_MOVIE_IDLE;
+static movie_header_t header;
+
+static uint8_t *input;
+static size_t inputPos, inputCapacity;
+static movie_checkpoint_t *checkpoints;
+static size_t checkpointPos, checkpointCapacity;
+
+static uint32_t frame;
+static uint32_t nextChange;
+static uint16_t nextBitmask;
+static uint16_t bitmask;
+static int8_t savedSpeedup;
+
+static struct {
+    uint startTime;
+    uint matched;
+    uint failed;
+    uint skipped;
+} playback;
+
+
+static bool grow(void **buffer, size_t *capacity, size_t needed, size_t itemSize)
+{
+    if (needed <= *capacity)
+        return true;
+
+    size_t newCapacity = MAX(needed, *capacity * 2 + 64);
+    void *newBuffer = realloc(*buffer, newCapacity * itemSize);
+
+    if (!newBuffer)
+        return false;
+
+    *buffer = newBuffer;
+    *capacity = newCapacity;
+    return true;
+}
+
+static void reset(void)
+{
+    free(input);
+    free(checkpoints);
+    input = NULL;
+    checkpoints = NULL;
+    inputPos = inputCapacity = 0;
+    checkpointPos = checkpointCapacity = 0;
+    frame = nextChange = 0;
+    bitmask = nextBitmask = 0;
+    mode = ODROID_MOVIE_IDLE;
+}
+
+static bool write_change(uint32_t delta, uint16_t value)
+{
+    if (!grow((void**)&input, &inputCapacity, inputPos + 7, 1))
+    {
+        printf("odroid_movie: Out of memory, recording stopped.\n");
+        odroid_movie_stop();
+        return false;
+    }
+
+    do {
+        input[inputPos++] = (delta & 0x7F) | (delta > 0x7F ? 0x80 : 0);
+        delta >>= 7;
+    } while (delta);
+
+    input[inputPos++] = value & 0xFF;
+    input[inputPos++] = value >> 8;
+
+    return true;
+}
+
+static bool read_change(void)
+{
+    uint32_t delta = 0;
+    int shift = 0;
+
+    while (inputPos < header.inputSize && shift < 32)
+    {
+        uint8_t byte = input[inputPos++];
+        delta |= (byte & 0x7F) << shift;
+        shift += 7;
+
+        if (!(byte & 0x80))
+        {
+            if (inputPos + 2 > header.inputSize)
+                break;
+
+            nextChange += delta;
+            nextBitmask = input[inputPos] | (input[inputPos + 1] << 8);
+            inputPos += 2;
+            return true;
+        }
+    }
+
+    nextChange = UINT32_MAX;
+    return false;
+}
+
+bool odroid_movie_record(int slot)
+{
+    odroid_movie_stop();
+
+    // The movie starts from a fresh save state so it can be replayed from the same point
+    if (!odroid_system_emu_save_state(slot))
+        return false;
+
+    header = (movie_header_t) {
+        .magic = MOVIE_MAGIC,
+        .version = MOVIE_VERSION,
+        .slot = slot,
+        .appId = odroid_system_get_app_id(),
+        .gameId = odroid_system_get_game_id(),
+    };
+
+    mode = ODROID_MOVIE_RECORDING;
+    printf("odroid_movie: Recording from slot %d.\n", slot);
+
+    return true;
+}
+
+bool odroid_movie_play(bool unthrottled)
+{
+    odroid_movie_stop();
+
+    char *pathName = odroid_system_get_path(ODROID_PATH_MOVIE, NULL);
+    bool success = false;
+
+    odroid_system_spi_lock_acquire(SPI_LOCK_SDCARD);
+
+    FILE *fp = fopen(pathName, "rb");
+    if (fp)
+    {
+        if (fread(&header, sizeof(header), 1, fp) == 1
+            && header.magic == MOVIE_MAGIC && header.version == MOVIE_VERSION)
+        {
+            input = malloc(header.inputSize + 1);
+            checkpoints = malloc(header.checkpoints * sizeof(movie_checkpoint_t) + 1);
+
+            success = input && checkpoints
+                && fread(input, header.inputSize, 1, fp) == (header.inputSize ? 1 : 0)
+                && fread(checkpoints, sizeof(movie_checkpoint_t), header.checkpoints, fp) == header.checkpoints;
+        }
+        fclose(fp);
+    }
+
+    odroid_system_spi_lock_release(SPI_LOCK_SDCARD);
+
+    free(pathName);
+
+    if (success && header.appId != odroid_system_get_app_id())
+    {
+        printf("odroid_movie: Movie was recorded with another emulator!\n");
+        success = false;
+    }
+
+    if (success && header.gameId != odroid_system_get_game_id())
+    {
+        printf("odroid_movie: Movie was recorded with another game!\n");
+        success = false;
+    }
+
+    if (success && !odroid_system_emu_load_state(header.slot))
+    {
+        printf("odroid_movie: Start state (slot %d) couldn't be loaded!\n", header.slot);
+        success = false;
+    }
+
+    if (!success)
+    {
+        printf("odroid_movie: Failed to load the movie.\n");
+        reset();
+        return false;
+    }
+
+    memset(&playback, 0, sizeof(playback));
+    read_change();
+
+    savedSpeedup = speedupEnabled;
+    if (unthrottled)
+        speedupEnabled = 3;
+
+    mode = ODROID_MOVIE_PLAYING;
+    playback.startTime = get_elapsed_time();
+    printf("odroid_movie: Playing %d frames from slot %d.\n", header.frames, header.slot);
+
+    return true;
+}
+
+void odroid_movie_stop(void)
+{
+    if (mode == ODROID_MOVIE_RECORDING)
+    {
+        char *pathName = odroid_system_get_path(ODROID_PATH_MOVIE, NULL);
+
+        header.frames = frame;
+        header.inputSize = inputPos;
+        header.checkpoints = checkpointPos;
+
+        odroid_system_spi_lock_acquire(SPI_LOCK_SDCARD);
+
+        FILE *fp = fopen(pathName, "wb");
+        bool success = fp
+            && fwrite(&header, sizeof(header), 1, fp) == 1
+            && fwrite(input, inputPos, 1, fp) == (inputPos ? 1 : 0)
+            && fwrite(checkpoints, sizeof(movie_checkpoint_t), checkpointPos, fp) == checkpointPos;
+        if (fp)
+            success = (fclose(fp) == 0) && success;
+
+        odroid_system_spi_lock_release(SPI_LOCK_SDCARD);
+
+        printf("odroid_movie: %s %d frames (%d bytes of input) to '%s'.\n",
+            success ? "Saved" : "Failed to save", frame, (int)inputPos, pathName);
+
+        free(pathName);
+    }
+    else if (mode == ODROID_MOVIE_PLAYING)
+    {
+        uint elapsed = get_elapsed_time_since(playback.startTime);
+
+        printf("odroid_movie: Played %d frames in %dms (%.2f fps), checkpoints: %d ok, %d failed, %d not drawn.\n",
+            frame, elapsed / 1000, frame / (elapsed / 1000000.f),
+            playback.matched, playback.failed, playback.skipped);
+
+        speedupEnabled = savedSpeedup;
+    }
+
+    reset();
+}
+
+odroid_movie_mode_t odroid_movie_get_mode(void)
+{
+    return mode;
+}
+
+bool odroid_movie_checkpoint_due(bool beforeLatch)
+{
+    // The frame counter is incremented by the latch
+    uint32_t current = beforeLatch ? frame : frame - 1;
+
+    if (mode == ODROID_MOVIE_IDLE || (!beforeLatch && frame == 0))
+        return false;
+
+    return (current % ODROID_MOVIE_CHECKPOINT_INTERVAL) == 0;
+}
+
+void odroid_movie_input(odroid_gamepad_state *state)
+{
+    if (mode == ODROID_MOVIE_RECORDING)
+    {
+        uint16_t keys = state->bitmask & ~MOVIE_IGNORED_KEYS;
+
+        if (keys != bitmask || frame == 0)
+        {
+            if (!write_change(frame - nextChange, keys))
+                return;
+            nextChange = frame;
+            bitmask = keys;
+        }
+    }
+    else if (mode == ODROID_MOVIE_PLAYING)
+    {
+        if (frame >= header.frames)
+        {
+            odroid_movie_stop();
+            return;
+        }
+
+        while (frame >= nextChange)
+        {
+            bitmask = nextBitmask;
+            read_change();
+        }
+
+        // Only the system buttons still come from the gamepad, so the menu can stop the movie
+        state->bitmask = bitmask | (state->bitmask & MOVIE_IGNORED_KEYS);
+
+        for (int i = 0; i < ODROID_INPUT_MAX; ++i)
+            state->values[i] = (state->bitmask >> i) & 1;
+    }
+    else
+    {
+        return;
+    }
+
+    frame++;
+}
+
+void odroid_movie_frame(odroid_video_frame *videoFrame)
+{
+    // The frame was latched (and counted) before it was emulated
+    uint32_t current = frame - 1;
+
+    if (mode == ODROID_MOVIE_IDLE || !videoFrame || frame == 0)
+        return;
+
+    if (current % ODROID_MOVIE_CHECKPOINT_INTERVAL)
+        return;
+
+    uint32_t crc = 0;
+    int lineSize = videoFrame->width * videoFrame->pixel_size;
+
+    for (int y = 0; y < videoFrame->height; y++)
+        crc = crc32_le(crc, (uint8_t*)videoFrame->buffer + y * videoFrame->stride, lineSize);
+
+    if (mode == ODROID_MOVIE_RECORDING)
+    {
+        if (grow((void**)&checkpoints, &checkpointCapacity, checkpointPos + 1, sizeof(movie_checkpoint_t)))
+            checkpoints[checkpointPos++] = (movie_checkpoint_t){current, crc};
+    }
+    else
+    {
+        // Checkpoints of frames that weren't drawn during playback are skipped
+        while (checkpointPos < header.checkpoints && checkpoints[checkpointPos].frame < current)
+        {
+            checkpointPos++;
+            playback.skipped++;
+        }
+
+        if (checkpointPos < header.checkpoints && checkpoints[checkpointPos].frame == current)
+        {
+            if (checkpoints[checkpointPos].crc == crc)
+            {
+                playback.matched++;
+            }
+            else
+            {
+                printf("odroid_movie: Checkpoint mismatch at frame %d!\n", current);
+                playback.failed++;
+            }
+            checkpointPos++;
+        }
+    }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "odroid_input.h"
+#include "odroid_display.h"
+
+// A checkpoint hash is taken on every Nth frame, if that frame is drawn
+#define ODROID_MOVIE_CHECKPOINT_INTERVAL 60
+
+typedef enum
+{
+    ODROID_MOVIE_IDLE = 0,
+    ODROID_MOVIE_RECORDING,
+    ODROID_MOVIE_PLAYING,
+} odroid_movie_mode_t;
+
+bool odroid_movie_record(int slot);
+bool odroid_movie_play(bool unthrottled);
+void odroid_movie_stop(void);
+odroid_movie_mode_t odroid_movie_get_mode(void);
+
+// True if the frame being emulated is a checkpoint, cores must draw it so that
+// recording and playback hash the same frames whatever their frame skipping.
+// Cores that pick the frames to draw before latching the input pass true.
+bool odroid_movie_checkpoint_due(bool beforeLatch);
+
+// Hooks called by odroid_input_gamepad_latch and odroid_display_queue_update
+void odroid_movie_input(odroid_gamepad_state *state);
+void odroid_movie_frame(odroid_video_frame *frame);
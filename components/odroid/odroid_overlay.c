@@ -12,6 +12,13 @@
 
 static uint16_t *overlay_buffer = NULL;
 static int dialog_open_depth = 0;
+static int state_slot = 0;
+static int state_slot_preview = -1;
+static int movie_action = 0;
+static const char *notice_text = NULL;
+static uint notice_start = 0;
+
+#define NOTICE_DURATION (2000 * 1000)
 
 short ODROID_FONT_WIDTH = 8;
 short ODROID_FONT_HEIGHT = 8;
@@ -352,6 +359,9 @@ int odroid_overlay_dialog(const char *header, odroid_dialog_choice_t *options, i
 
     odroid_input_wait_for_key(last_key, false);
 
+    // The keys pressed in the dialog (MENU, A, B...) must not reach the game
+    odroid_input_flush();
+
     odroid_display_force_refresh();
 
     dialog_open_depth--;
@@ -383,6 +393,31 @@ bool odroid_overlay_dialog_is_open(void)
     return dialog_open_depth > 0;
 }
 
+void odroid_overlay_notice(const char *text)
+{
+    notice_start = get_elapsed_time();
+    notice_text = text;
+}
+
+void odroid_overlay_draw_notice(void)
+{
+    const char *text = notice_text;
+
+    if (!text || dialog_open_depth > 0)
+        return;
+
+    if (get_elapsed_time_since(notice_start) > NOTICE_DURATION)
+    {
+        // The next frame is drawn in full over the notice
+        notice_text = NULL;
+        odroid_display_force_refresh();
+        return;
+    }
+
+    odroid_overlay_draw_text(0, ODROID_SCREEN_HEIGHT - ODROID_FONT_HEIGHT, ODROID_SCREEN_WIDTH,
+        text, C_WHITE, C_BLACK);
+}
+
 static bool volume_update_cb(odroid_dialog_choice_t *option, odroid_dialog_event_t event)
 {
     int8_t level = odroid_audio_volume_get();
@@ -548,6 +583,51 @@ int odroid_overlay_game_settings_menu(odroid_dialog_choice_t *extra_options)
     return r;
 }
 
+static bool slot_update_cb(odroid_dialog_choice_t *option, odroid_dialog_event_t event)
+{
+    int x = 8, y = ODROID_SCREEN_HEIGHT - 16 - ODROID_THUMBNAIL_HEIGHT - 8;
+
+    if (event == ODROID_DIALOG_PREV && --state_slot < 0) state_slot = ODROID_STATE_SLOTS - 1;
+    if (event == ODROID_DIALOG_NEXT && ++state_slot >= ODROID_STATE_SLOTS) state_slot = 0;
+
+    sprintf(option->value, "%d", state_slot);
+
+    // Preview the slot from the thumbnail stored in its header
+    if (state_slot_preview != state_slot)
+    {
+        uint16_t *thumbnail = malloc(ODROID_THUMBNAIL_WIDTH * ODROID_THUMBNAIL_HEIGHT * 2);
+
+        if (thumbnail && odroid_system_emu_read_thumbnail(state_slot, thumbnail))
+            odroid_display_write(x, y, ODROID_THUMBNAIL_WIDTH, ODROID_THUMBNAIL_HEIGHT, thumbnail);
+        else
+            odroid_overlay_draw_fill_rect(x, y, ODROID_THUMBNAIL_WIDTH, ODROID_THUMBNAIL_HEIGHT, C_BLACK);
+
+        free(thumbnail);
+        state_slot_preview = state_slot;
+    }
+
+    // Only a selector, Save/Load act on it
+    return false;
+}
+
+static bool movie_update_cb(odroid_dialog_choice_t *option, odroid_dialog_event_t event)
+{
+    static const char *actions[] = {"Record", "Replay", "Bench"};
+
+    if (odroid_movie_get_mode() != ODROID_MOVIE_IDLE)
+    {
+        strcpy(option->value, "Stop");
+        return event == ODROID_DIALOG_ENTER;
+    }
+
+    if (event == ODROID_DIALOG_PREV && --movie_action < 0) movie_action = 2;
+    if (event == ODROID_DIALOG_NEXT && ++movie_action > 2) movie_action = 0;
+
+    strcpy(option->value, actions[movie_action]);
+
+    return event == ODROID_DIALOG_ENTER;
+}
+
 int odroid_overlay_game_menu()
 {
     odroid_dialog_choice_t choices[] = {
@@ -555,6 +635,8 @@ int odroid_overlay_game_menu()
         {10, "Save & Continue", "",  1, NULL},
         {20, "Save & Quit", "", 1, NULL},
         {30, "Reload", "", 1, NULL},
+        {60, "Slot", "0", 1, &slot_update_cb},
+        {70, "Movie", "", 1, &movie_update_cb},
         #ifdef ENABLE_NETPLAY
         {40, "Netplay", "", 1, NULL},
         #else
@@ -570,16 +652,27 @@ int odroid_overlay_game_menu()
     odroid_audio_mute(true);
     wait_all_keys_released();
     draw_game_status_bar(stats);
+    state_slot_preview = -1;
 
     int r = odroid_overlay_dialog("Retro-Go", choices, 0);
 
+    // Save & Quit always uses slot 0, it's the one resumed from the launcher
     switch (r)
     {
-        case 10: odroid_system_emu_save_state(0); break;
+        case 10: odroid_system_emu_save_state(state_slot); break;
         case 20: odroid_system_emu_save_state(0); odroid_system_switch_app(0); break;
-        case 30: odroid_system_emu_load_state(0); break; // esp_restart();
+        case 30: odroid_system_emu_load_state(state_slot); break; // esp_restart();
         case 40: odroid_netplay_quick_start(); break;
         case 50: odroid_system_switch_app(0); break;
+        case 70:
+            // Movies start from the selected slot, Bench replays unthrottled
+            if (odroid_movie_get_mode() != ODROID_MOVIE_IDLE)
+                odroid_movie_stop();
+            else if (movie_action == 0)
+                odroid_movie_record(state_slot);
+            else
+                odroid_movie_play(movie_action == 2);
+            break;
     }
 
     odroid_audio_mute(false);
@@ -49,6 +49,11 @@ int odroid_overlay_confirm(const char *text, bool yes_selected);
 void odroid_overlay_alert(const char *text);
 bool odroid_overlay_dialog_is_open(void);
 
+// Shows text at the bottom of the screen for a moment without pausing the game,
+// text must stay valid. It's drawn by display_task after each frame.
+void odroid_overlay_notice(const char *text);
+void odroid_overlay_draw_notice(void);
+
 int odroid_overlay_settings_menu(odroid_dialog_choice_t *extra_options);
 int odroid_overlay_game_settings_menu(odroid_dialog_choice_t *extra_options);
 int odroid_overlay_game_menu();
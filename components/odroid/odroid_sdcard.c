@@ -102,60 +102,170 @@ size_t odroid_sdcard_get_filesize(const char* path)
     return ret;
 }
 
-size_t odroid_sdcard_copy_file_to_memory(const char* path, void* buf, size_t buf_size)
+// Reads are done in large sector-aligned chunks straight into the destination,
+// the SD lock is released between chunks so other tasks can use the bus.
+#define SDCARD_READ_CHUNK (64 * 1024)
+
+static void report_throughput(const char *func, const char *path, size_t size, uint startTime)
 {
-    assert(sdcardOpen == true);
+    uint elapsed = get_elapsed_time_since(startTime);
+
+    printf("%s: Loaded %d bytes in %dms (%.2f MB/s). path='%s'\n", func, (int)size, elapsed / 1000,
+        elapsed ? (size / (1024.f * 1024.f)) / (elapsed / 1000000.f) : 0.f, path);
+}
 
+static FILE *open_unbuffered(const char *path, size_t *size)
+{
     odroid_system_spi_lock_acquire(SPI_LOCK_SDCARD);
 
-    size_t block_size = MIN(4096, buf_size);
-    size_t ret = 0, count = 0;
+    FILE *f = fopen(path, "rb");
+
+    // Without the stdio buffer FATFS transfers whole sectors directly into our buffer
+    if (f)
+    {
+        setvbuf(f, NULL, _IONBF, 0);
+        fseek(f, 0, SEEK_END);
+        *size = ftell(f);
+        fseek(f, 0, SEEK_SET);
+    }
+
+    odroid_system_spi_lock_release(SPI_LOCK_SDCARD);
+
+    return f;
+}
+
+static void close_unbuffered(FILE *f)
+{
+    odroid_system_spi_lock_acquire(SPI_LOCK_SDCARD);
+    fclose(f);
+    odroid_system_spi_lock_release(SPI_LOCK_SDCARD);
+}
+
+size_t odroid_sdcard_copy_file_to_memory(const char* path, void* buf, size_t buf_size)
+{
+    assert(sdcardOpen == true);
+
+    uint startTime = get_elapsed_time();
+    size_t ret = 0, count = 0, file_size = 0;
     FILE* f;
 
-    if ((f = fopen(path, "rb")))
+    if ((f = open_unbuffered(path, &file_size)))
     {
-        do {
+        size_t size = MIN(buf_size, file_size);
+
+        while (ret < size)
+        {
+            size_t block_size = MIN(SDCARD_READ_CHUNK, size - ret);
+
+            odroid_system_spi_lock_acquire(SPI_LOCK_SDCARD);
             count = fread(buf + ret, 1, block_size, f);
+            odroid_system_spi_lock_release(SPI_LOCK_SDCARD);
+
             ret += count;
-        } while (count == block_size && ret < buf_size);
 
-        fclose(f);
+            if (count != block_size)
+                break;
+        }
+
+        close_unbuffered(f);
+
+        if (ret >= SDCARD_READ_CHUNK)
+            report_throughput(__func__, path, ret, startTime);
     }
     else
         printf("%s: fopen failed. path='%s'\n", __func__, path);
 
+    return ret;
+}
+
+static size_t zip_read(void *opaque, mz_uint64 offset, void *buf, size_t size)
+{
+    FILE *f = (FILE *)opaque;
+    size_t ret = 0;
+
+    odroid_system_spi_lock_acquire(SPI_LOCK_SDCARD);
+
+    if (fseek(f, offset, SEEK_SET) == 0)
+        ret = fread(buf, 1, size, f);
+
     odroid_system_spi_lock_release(SPI_LOCK_SDCARD);
 
     return ret;
 }
 
-size_t odroid_sdcard_unzip_file_to_memory(const char* path, void* buf, size_t buf_size)
+// Returns the first entry matching ext, or the first file if none matches
+static int zip_find_entry(mz_zip_archive *zip, const char *ext)
 {
-    assert(sdcardOpen == true);
+    char filename[128];
+    int found = -1;
 
-    odroid_system_spi_lock_acquire(SPI_LOCK_SDCARD);
+    for (int i = 0; i < mz_zip_reader_get_num_files(zip); i++)
+    {
+        if (mz_zip_reader_is_file_a_directory(zip, i))
+            continue;
 
-    size_t ret = 0;
+        if (found < 0)
+            found = i;
+
+        if (!ext)
+            break;
+
+        mz_zip_reader_get_filename(zip, i, filename, sizeof(filename));
+        const char *file_ext = odroid_sdcard_get_extension(filename);
+
+        if (file_ext && strcasecmp(file_ext, ext) == 0)
+        {
+            found = i;
+            break;
+        }
+    }
+
+    return found;
+}
+
+size_t odroid_sdcard_unzip_file_to_memory(const char* path, const char *ext, void* buf, size_t buf_size)
+{
+    assert(sdcardOpen == true);
+
+    uint startTime = get_elapsed_time();
+    size_t ret = 0, file_size = 0;
     mz_zip_archive zip_archive;
+    FILE *f;
+
+    if (!(f = open_unbuffered(path, &file_size)))
+    {
+        printf("%s: fopen failed. path='%s'\n", __func__, path);
+        return 0;
+    }
 
     memset(&zip_archive, 0, sizeof(zip_archive));
+    zip_archive.m_pRead = &zip_read;
+    zip_archive.m_pIO_opaque = f;
 
-    if (mz_zip_reader_init_file(&zip_archive, path, 0))
+    // Entries are inflated directly into buf as the compressed data is read in
+    if (mz_zip_reader_init(&zip_archive, file_size, 0))
     {
         printf("%s: Opened archive %s\n", __func__, path);
         mz_zip_archive_file_stat file_stat;
-        if (mz_zip_reader_file_stat(&zip_archive, 0, &file_stat))
+        int index = zip_find_entry(&zip_archive, ext);
+
+        if (index >= 0 && mz_zip_reader_file_stat(&zip_archive, index, &file_stat))
         {
             printf("%s: Extracting file %s\n", __func__, file_stat.m_filename);
-            if (mz_zip_reader_extract_to_mem(&zip_archive, 0, buf, buf_size, 0))
+            if (file_stat.m_uncomp_size > buf_size)
+            {
+                printf("%s: File is too large (%d bytes)\n", __func__, (int)file_stat.m_uncomp_size);
+            }
+            else if (mz_zip_reader_extract_to_mem(&zip_archive, index, buf, buf_size, 0))
             {
                 ret = file_stat.m_uncomp_size;
+                report_throughput(__func__, path, ret, startTime);
             }
         }
         mz_zip_reader_end(&zip_archive);
     }
 
-    odroid_system_spi_lock_release(SPI_LOCK_SDCARD);
+    close_unbuffered(f);
 
     return ret;
 }
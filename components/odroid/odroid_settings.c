@@ -1,3 +1,5 @@
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 #include <nvs_flash.h>
 #include <string.h>
 
@@ -22,7 +24,101 @@ static const char* NvsKey_DispRotation = "DispRotate";
 static const char* NvsKey_DispOverscan = "Overscan";
 static const char* NvsKey_SpriteLimit  = "SpriteL";
 
+// Settings are served from RAM and written back to NVS in batches, so that
+// changing options in the menus doesn't wear the flash or stall the emulator.
+#define SETTINGS_CACHE_SIZE   64
+#define SETTINGS_COMMIT_DELAY 2000000 // us since the last change
+
+typedef enum
+{
+    SETTING_MISSING = 0,
+    SETTING_INT32,
+    SETTING_STRING,
+} setting_type_t;
+
+typedef struct
+{
+    char key[16];
+    setting_type_t type;
+    bool dirty;
+    union {
+        int32_t i32;
+        char *str;
+    } value;
+} setting_t;
+
 static nvs_handle my_handle;
+static SemaphoreHandle_t cacheLock;
+static setting_t cache[SETTINGS_CACHE_SIZE];
+static int cacheCount = 0;
+static uint lastChange = 0;
+static bool pending = false;
+
+
+static setting_t *cache_find(const char *key)
+{
+    for (int i = 0; i < cacheCount; i++)
+    {
+        if (strcmp(cache[i].key, key) == 0)
+            return &cache[i];
+    }
+    return NULL;
+}
+
+// Returns the key's entry, reading it from NVS the first time it's requested
+static setting_t *cache_get(const char *key, setting_type_t type)
+{
+    setting_t *entry = cache_find(key);
+
+    if (entry || cacheCount == SETTINGS_CACHE_SIZE || strlen(key) >= sizeof(entry->key))
+        return entry;
+
+    entry = &cache[cacheCount++];
+    memset(entry, 0, sizeof(setting_t));
+    strcpy(entry->key, key);
+
+    esp_err_t err = ESP_ERR_NVS_NOT_FOUND;
+
+    if (type == SETTING_STRING)
+    {
+        size_t required_size;
+        err = nvs_get_str(my_handle, key, NULL, &required_size);
+        if (err == ESP_OK)
+        {
+            entry->value.str = rg_alloc(required_size, MEM_ANY);
+            err = nvs_get_str(my_handle, key, entry->value.str, &required_size);
+            if (err == ESP_OK)
+            {
+                entry->type = SETTING_STRING;
+            }
+            else
+            {
+                free(entry->value.str);
+                entry->value.str = NULL;
+            }
+        }
+    }
+    else
+    {
+        err = nvs_get_i32(my_handle, key, &entry->value.i32);
+        if (err == ESP_OK)
+            entry->type = SETTING_INT32;
+    }
+
+    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND)
+    {
+        printf("%s: key='%s' err=%d\n", __func__, key, err);
+    }
+
+    return entry;
+}
+
+static void cache_set_dirty(setting_t *entry)
+{
+    entry->dirty = true;
+    lastChange = get_elapsed_time();
+    pending = true;
+}
 
 void odroid_settings_init()
 {
@@ -37,74 +133,170 @@ void odroid_settings_init()
 
 	err = nvs_open(NvsNamespace, NVS_READWRITE, &my_handle);
 	assert(err == ESP_OK);
+
+    cacheLock = xSemaphoreCreateMutex();
+
+    // Preload the global settings, every app reads them during boot
+    cache_get(NvsKey_RomFilePath, SETTING_STRING);
+    cache_get(NvsKey_StartAction, SETTING_INT32);
+    cache_get(NvsKey_Backlight, SETTING_INT32);
+    cache_get(NvsKey_AudioSink, SETTING_INT32);
+    cache_get(NvsKey_Volume, SETTING_INT32);
+    cache_get(NvsKey_StartupApp, SETTING_INT32);
+    cache_get(NvsKey_FontSize, SETTING_INT32);
 }
 
-char* odroid_settings_string_get(const char *key, char *default_value)
+void odroid_settings_commit()
 {
-    char* result = default_value;
+    if (!pending)
+        return;
+
+    xSemaphoreTake(cacheLock, portMAX_DELAY);
+
+    int count = 0;
 
-    size_t required_size;
-    esp_err_t err = nvs_get_str(my_handle, key, NULL, &required_size);
-    if (err == ESP_OK)
+    for (int i = 0; i < cacheCount; i++)
     {
-        char* value = rg_alloc(required_size, MEM_ANY);
+        setting_t *entry = &cache[i];
+        esp_err_t err = ESP_OK;
 
-        esp_err_t err = nvs_get_str(my_handle, key, value, &required_size);
-        if (err == ESP_OK)
+        if (!entry->dirty)
+            continue;
+
+        if (entry->type == SETTING_STRING)
+            err = nvs_set_str(my_handle, entry->key, entry->value.str);
+        else if (entry->type == SETTING_INT32)
+            err = nvs_set_i32(my_handle, entry->key, entry->value.i32);
+
+        if (err != ESP_OK)
         {
-            result = value;
+            printf("%s: key='%s' err=%d\n", __func__, entry->key, err);
         }
+
+        entry->dirty = false;
+        count++;
     }
 
-    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND)
+    if (count > 0)
     {
-        printf("%s: key='%s' err=%d\n", __func__, key, err);
+        nvs_commit(my_handle);
+        printf("%s: %d setting(s) committed.\n", __func__, count);
     }
 
+    pending = false;
+
+    xSemaphoreGive(cacheLock);
+}
+
+void odroid_settings_commit_idle()
+{
+    if (pending && get_elapsed_time_since(lastChange) > SETTINGS_COMMIT_DELAY)
+    {
+        odroid_settings_commit();
+    }
+}
+
+// The returned string belongs to the settings and remains valid until the key is set again
+const char* odroid_settings_string_get(const char *key, const char *default_value)
+{
+    const char* result = default_value;
+
+    xSemaphoreTake(cacheLock, portMAX_DELAY);
+
+    setting_t *entry = cache_get(key, SETTING_STRING);
+    if (entry && entry->type == SETTING_STRING)
+    {
+        result = entry->value.str;
+    }
+
+    xSemaphoreGive(cacheLock);
+
     return result;
 }
 
-void odroid_settings_string_set(const char *key, char *value)
+void odroid_settings_string_set(const char *key, const char *value)
 {
-    // To do: Check if value is same and avoid overwrite
-    esp_err_t ret = nvs_set_str(my_handle, key, value);
-    nvs_commit(my_handle);
+    xSemaphoreTake(cacheLock, portMAX_DELAY);
+
+    setting_t *entry = cache_get(key, SETTING_STRING);
 
-    if (ret != ESP_OK)
+    if (!entry)
     {
-        printf("%s: key='%s' err=%d\n", __func__, key, ret);
+        // The cache is full, go straight to NVS
+        esp_err_t ret = nvs_set_str(my_handle, key, value);
+        nvs_commit(my_handle);
+
+        if (ret != ESP_OK)
+        {
+            printf("%s: key='%s' err=%d\n", __func__, key, ret);
+        }
+    }
+    else if (entry->type != SETTING_STRING || strcmp(entry->value.str, value) != 0)
+    {
+        char *copy = rg_alloc(strlen(value) + 1, MEM_ANY);
+        strcpy(copy, value);
+
+        if (entry->type == SETTING_STRING)
+            free(entry->value.str);
+
+        entry->value.str = copy;
+        entry->type = SETTING_STRING;
+        cache_set_dirty(entry);
     }
+
+    xSemaphoreGive(cacheLock);
 }
 
 int32_t odroid_settings_int32_get(const char *key, int32_t default_value)
 {
-    int current = default_value;
-    esp_err_t ret = ESP_OK;
+    int32_t result = default_value;
 
-    ret = nvs_get_i32(my_handle, key, &current);
+    xSemaphoreTake(cacheLock, portMAX_DELAY);
 
-    if (ret != ESP_OK && ret != ESP_ERR_NVS_NOT_FOUND)
+    setting_t *entry = cache_get(key, SETTING_INT32);
+    if (entry && entry->type == SETTING_INT32)
+    {
+        result = entry->value.i32;
+    }
+    else if (!entry)
     {
-        printf("%s: key='%s' err=%d\n", __func__, key, ret);
+        // The cache is full, go straight to NVS
+        nvs_get_i32(my_handle, key, &result);
     }
 
-    return current;
+    xSemaphoreGive(cacheLock);
+
+    return result;
 }
 
 void odroid_settings_int32_set(const char *key, int32_t value)
 {
-    esp_err_t ret = ESP_OK;
+    xSemaphoreTake(cacheLock, portMAX_DELAY);
 
-    if (odroid_settings_int32_get(key, 0) != value)
+    setting_t *entry = cache_get(key, SETTING_INT32);
+
+    if (!entry)
     {
-        ret = nvs_set_i32(my_handle, key, value);
+        // The cache is full, go straight to NVS
+        esp_err_t ret = nvs_set_i32(my_handle, key, value);
         nvs_commit(my_handle);
-    }
 
-    if (ret != ESP_OK)
+        if (ret != ESP_OK)
+        {
+            printf("%s: key='%s' err=%d\n", __func__, key, ret);
+        }
+    }
+    else if (entry->type != SETTING_INT32 || entry->value.i32 != value)
     {
-        printf("%s: key='%s' err=%d\n", __func__, key, ret);
+        if (entry->type == SETTING_STRING)
+            free(entry->value.str);
+
+        entry->value.i32 = value;
+        entry->type = SETTING_INT32;
+        cache_set_dirty(entry);
     }
+
+    xSemaphoreGive(cacheLock);
 }
 
 
@@ -133,11 +325,11 @@ void odroid_settings_FontSize_set(int32_t value)
 }
 
 
-char* odroid_settings_RomFilePath_get()
+const char* odroid_settings_RomFilePath_get()
 {
     return odroid_settings_string_get(NvsKey_RomFilePath, NULL);
 }
-void odroid_settings_RomFilePath_set(char* value)
+void odroid_settings_RomFilePath_set(const char* value)
 {
     odroid_settings_string_set(NvsKey_RomFilePath, value);
 }
@@ -10,26 +10,78 @@
 #include <esp_sleep.h>
 #include <driver/rtc_io.h>
 #include <rom/crc.h>
+#include <esp_vfs.h>
+#include <sys/stat.h>
 #include <string.h>
 #include <stdio.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
 
 #include "odroid_image_sdcard.h"
 #include "odroid_system.h"
+#include "../miniz/miniz.h"
 
 int8_t speedupEnabled = 0;
 
 static uint applicationId = 0;
 static uint gameId = 0;
 static uint startAction = 0;
-static char *romPath = NULL;
+static const char *romPath = NULL;
 static state_handler_t loadState;
 static state_handler_t saveState;
 
 static SemaphoreHandle_t spiMutex;
 static spi_lock_res_t spiMutexOwner;
+static TaskHandle_t spiMutexHolder;
+static int spiMutexDepth;
 static runtime_stats_t statistics;
 static runtime_counters_t counters;
 
+// Save states are captured to RAM by the emulator's handler, then written out by save_task
+#define STATE_RAM_PATH   "/ramstate"
+#define STATE_RAM_FILE   STATE_RAM_PATH "/state"
+#define STATE_CHUNK_SIZE (16 * 1024)
+
+// On the card a state is a header followed by deflated sections, see save_task
+#define STATE_MAGIC      0x54534752 // "RGST"
+#define STATE_VERSION    1
+#define STATE_SECTION_THUMBNAIL 1
+#define STATE_SECTION_DATA      2
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t sections;
+    uint32_t appId;
+    uint32_t gameId;
+    uint32_t timestamp;
+    uint16_t thumbWidth;
+    uint16_t thumbHeight;
+} state_header_t;
+
+typedef struct {
+    uint32_t type;
+    uint32_t size;
+    uint32_t packedSize;
+    uint32_t crc;
+} state_section_t;
+
+static struct {
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+    size_t pos;
+    bool open;
+} stateFile;
+
+static TaskHandle_t saveTask;
+static SemaphoreHandle_t saveTaskSem;
+static SemaphoreHandle_t saveDoneSem;
+static char *saveTaskPaths[3];
+static uint16_t *saveThumbnail;
+static bool saveHasThumbnail;
+
 static void odroid_system_monitor_task(void *arg);
 
 
@@ -108,6 +160,257 @@ void odroid_system_init(int appId, int sampleRate)
     printf("odroid_system_init: System ready!\n\n");
 }
 
+static int state_file_open(const char *path, int flags, int mode)
+{
+    if (stateFile.open)
+    {
+        errno = EBUSY;
+        return -1;
+    }
+
+    if ((flags & O_ACCMODE) != O_RDONLY && (flags & (O_TRUNC|O_CREAT)))
+    {
+        stateFile.size = 0;
+    }
+
+    stateFile.pos = 0;
+    stateFile.open = true;
+
+    return 0;
+}
+
+static int state_file_close(int fd)
+{
+    stateFile.open = false;
+    return 0;
+}
+
+static bool state_file_reserve(size_t size)
+{
+    if (size > stateFile.capacity)
+    {
+        size_t capacity = MAX(size, stateFile.capacity * 2);
+        void *buffer = heap_caps_realloc(stateFile.data, capacity, MEM_SLOW);
+        if (!buffer)
+        {
+            return false;
+        }
+        stateFile.data = buffer;
+        stateFile.capacity = capacity;
+    }
+    return true;
+}
+
+static ssize_t state_file_write(int fd, const void *data, size_t size)
+{
+    size_t end = stateFile.pos + size;
+
+    if (!state_file_reserve(end))
+    {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    memcpy(stateFile.data + stateFile.pos, data, size);
+    stateFile.pos = end;
+    stateFile.size = MAX(stateFile.size, end);
+
+    return size;
+}
+
+static ssize_t state_file_read(int fd, void *data, size_t size)
+{
+    size = MIN(size, stateFile.size - MIN(stateFile.pos, stateFile.size));
+    memcpy(data, stateFile.data + stateFile.pos, size);
+    stateFile.pos += size;
+    return size;
+}
+
+static off_t state_file_lseek(int fd, off_t offset, int mode)
+{
+    if (mode == SEEK_CUR)
+        offset += stateFile.pos;
+    else if (mode == SEEK_END)
+        offset += stateFile.size;
+
+    if (offset < 0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    stateFile.pos = offset;
+    return offset;
+}
+
+static int state_file_fstat(int fd, struct stat *st)
+{
+    memset(st, 0, sizeof(*st));
+    st->st_mode = S_IFREG;
+    st->st_size = stateFile.size;
+    return 0;
+}
+
+// Release the bus between chunks so the display keeps going
+static bool state_write(FILE *fp, const void *data, size_t size)
+{
+    for (size_t written = 0; written < size; written += STATE_CHUNK_SIZE)
+    {
+        size_t chunk = MIN(size - written, STATE_CHUNK_SIZE);
+        odroid_system_spi_lock_acquire(SPI_LOCK_SDCARD);
+        size_t count = fwrite((uint8_t*)data + written, 1, chunk, fp);
+        odroid_system_spi_lock_release(SPI_LOCK_SDCARD);
+        if (count != chunk)
+            return false;
+    }
+    return true;
+}
+
+static bool state_write_section(FILE *fp, uint32_t type, const void *data, size_t size)
+{
+    int flags = tdefl_create_comp_flags_from_zip_params(1, -MZ_DEFAULT_WINDOW_BITS, MZ_DEFAULT_STRATEGY);
+    size_t packedSize = 0;
+    void *packed = tdefl_compress_mem_to_heap(data, size, &packedSize, flags);
+
+    if (!packed)
+        return false;
+
+    state_section_t section = {
+        .type = type,
+        .size = size,
+        .packedSize = packedSize,
+        .crc = crc32_le(0, data, size),
+    };
+
+    bool success = state_write(fp, &section, sizeof(section))
+                && state_write(fp, packed, packedSize);
+
+    printf("state_write_section: Section %d: %d bytes packed to %d.\n", type, (int)size, (int)packedSize);
+
+    free(packed);
+
+    return success;
+}
+
+// Returns the packed data of a section, the caller inflates it with state_inflate
+static void *state_find_section(FILE *fp, uint32_t type, state_section_t *section)
+{
+    while (fread(section, sizeof(*section), 1, fp) == 1)
+    {
+        if (section->type == type)
+        {
+            void *packed = heap_caps_malloc(section->packedSize, MEM_SLOW);
+            if (packed && fread(packed, section->packedSize, 1, fp) == 1)
+                return packed;
+            free(packed);
+            return NULL;
+        }
+
+        if (fseek(fp, section->packedSize, SEEK_CUR) != 0)
+            break;
+    }
+    return NULL;
+}
+
+static bool state_inflate(const state_section_t *section, const void *packed, void *out)
+{
+    return tinfl_decompress_mem_to_mem(out, section->size, packed, section->packedSize, 0) == section->size
+        && crc32_le(0, out, section->size) == section->crc;
+}
+
+static bool state_read_header(FILE *fp, state_header_t *header)
+{
+    return fread(header, sizeof(*header), 1, fp) == 1
+        && header->magic == STATE_MAGIC
+        && header->version == STATE_VERSION;
+}
+
+static void save_commit(void)
+{
+    char *saveName = saveTaskPaths[0];
+    char *backName = saveTaskPaths[1];
+    char *tempName = saveTaskPaths[2];
+    bool success = false;
+
+    odroid_system_spi_lock_acquire(SPI_LOCK_SDCARD);
+    FILE *fp = fopen(tempName, "wb");
+    odroid_system_spi_lock_release(SPI_LOCK_SDCARD);
+
+    if (fp)
+    {
+        state_header_t header = {
+            .magic = STATE_MAGIC,
+            .version = STATE_VERSION,
+            .sections = saveHasThumbnail ? 2 : 1,
+            .appId = applicationId,
+            .gameId = gameId,
+            .timestamp = time(NULL),
+            .thumbWidth = saveHasThumbnail ? ODROID_THUMBNAIL_WIDTH : 0,
+            .thumbHeight = saveHasThumbnail ? ODROID_THUMBNAIL_HEIGHT : 0,
+        };
+
+        bool written = state_write(fp, &header, sizeof(header));
+
+        if (written && saveHasThumbnail)
+        {
+            written = state_write_section(fp, STATE_SECTION_THUMBNAIL, saveThumbnail,
+                ODROID_THUMBNAIL_WIDTH * ODROID_THUMBNAIL_HEIGHT * 2);
+        }
+
+        if (written)
+        {
+            written = state_write_section(fp, STATE_SECTION_DATA, stateFile.data, stateFile.size);
+        }
+
+        odroid_system_spi_lock_acquire(SPI_LOCK_SDCARD);
+
+        if (fclose(fp) == 0 && written)
+        {
+            rename(saveName, backName);
+
+            if (rename(tempName, saveName) == 0)
+            {
+                unlink(backName);
+                success = true;
+            }
+        }
+
+        unlink(tempName);
+        odroid_system_spi_lock_release(SPI_LOCK_SDCARD);
+    }
+
+    printf("save_commit: %s %d bytes to '%s'.\n", success ? "Wrote" : "Failed to write",
+        (int)stateFile.size, saveName);
+
+    free(saveName);
+    free(backName);
+    free(tempName);
+
+    odroid_overlay_notice(success ? "State saved" : "Save failed!");
+    odroid_system_set_led(0);
+}
+
+static void save_task(void *arg)
+{
+    while (1)
+    {
+        xSemaphoreTake(saveTaskSem, portMAX_DELAY);
+        save_commit();
+        xSemaphoreGive(saveDoneSem);
+    }
+
+    vTaskDelete(NULL);
+}
+
+static void odroid_system_wait_for_save()
+{
+    if (saveDoneSem)
+    {
+        xSemaphoreTake(saveDoneSem, portMAX_DELAY);
+        xSemaphoreGive(saveDoneSem);
+    }
+}
+
 void odroid_system_emu_init(state_handler_t load, state_handler_t save, netplay_callback_t netplay_cb)
 {
     uint8_t buffer[0x150];
@@ -153,6 +456,29 @@ void odroid_system_emu_init(state_handler_t load, state_handler_t save, netplay_
     loadState = load;
     saveState = save;
 
+    const esp_vfs_t stateVfs = {
+        .flags = ESP_VFS_FLAG_DEFAULT,
+        .open = &state_file_open,
+        .close = &state_file_close,
+        .write = &state_file_write,
+        .read = &state_file_read,
+        .lseek = &state_file_lseek,
+        .fstat = &state_file_fstat,
+    };
+    esp_vfs_register(STATE_RAM_PATH, &stateVfs, NULL);
+
+    // The writer is started before the emulator claims most of the internal memory
+    saveThumbnail = rg_alloc(ODROID_THUMBNAIL_WIDTH * ODROID_THUMBNAIL_HEIGHT * 2, MEM_SLOW);
+    saveTaskSem = xSemaphoreCreateBinary();
+    saveDoneSem = xSemaphoreCreateBinary();
+    xSemaphoreGive(saveDoneSem);
+
+    if (xTaskCreatePinnedToCore(&save_task, "save_task", 4096, NULL, 1, &saveTask, 0) != pdPASS)
+    {
+        printf("odroid_system_emu_init: Failed to create save_task, saving will block.\n");
+        saveTask = NULL;
+    }
+
     printf("odroid_system_emu_init: Init done. GameId=%08X\n", gameId);
 }
 
@@ -181,9 +507,9 @@ const char* odroid_system_get_rom_path()
     return romPath;
 }
 
-char* odroid_system_get_path(emu_path_type_t type, char *_romPath)
+char* odroid_system_get_path(emu_path_type_t type, const char *_romPath)
 {
-    char *fileName = _romPath ?: romPath;
+    const char *fileName = _romPath ?: romPath;
     char buffer[256];
 
     if (strstr(fileName, ODROID_BASE_PATH_ROMS))
@@ -200,12 +526,17 @@ char* odroid_system_get_path(emu_path_type_t type, char *_romPath)
     switch (type)
     {
         case ODROID_PATH_SAVE_STATE:
+            strcpy(buffer, ODROID_BASE_PATH_SAVES);
+            strcat(buffer, fileName);
+            strcat(buffer, ".sav");
+            break;
+
         case ODROID_PATH_SAVE_STATE_1:
         case ODROID_PATH_SAVE_STATE_2:
         case ODROID_PATH_SAVE_STATE_3:
             strcpy(buffer, ODROID_BASE_PATH_SAVES);
             strcat(buffer, fileName);
-            strcat(buffer, ".sav");
+            sprintf(buffer + strlen(buffer), ".sav%d", type - ODROID_PATH_SAVE_STATE);
             break;
 
         case ODROID_PATH_SAVE_BACK:
@@ -214,6 +545,14 @@ char* odroid_system_get_path(emu_path_type_t type, char *_romPath)
             strcat(buffer, ".sav.bak");
             break;
 
+        case ODROID_PATH_SAVE_BACK_1:
+        case ODROID_PATH_SAVE_BACK_2:
+        case ODROID_PATH_SAVE_BACK_3:
+            strcpy(buffer, ODROID_BASE_PATH_SAVES);
+            strcat(buffer, fileName);
+            sprintf(buffer + strlen(buffer), ".sav%d.bak", type - ODROID_PATH_SAVE_BACK);
+            break;
+
         case ODROID_PATH_SAVE_SRAM:
             strcpy(buffer, ODROID_BASE_PATH_SAVES);
             strcat(buffer, fileName);
@@ -235,6 +574,18 @@ char* odroid_system_get_path(emu_path_type_t type, char *_romPath)
             strcat(buffer, ".crc");
             break;
 
+        case ODROID_PATH_MOVIE:
+            strcpy(buffer, ODROID_BASE_PATH_SAVES);
+            strcat(buffer, fileName);
+            strcat(buffer, ".rgm");
+            break;
+
+        case ODROID_PATH_ROM_CACHE:
+            strcpy(buffer, ODROID_BASE_PATH_ROM_CACHE);
+            strcat(buffer, fileName);
+            strcat(buffer, ".cache");
+            break;
+
         default:
             abort();
     }
@@ -250,13 +601,49 @@ bool odroid_system_emu_load_state(int slot)
         return false;
     }
 
+    if (slot < 0 || slot >= ODROID_STATE_SLOTS)
+    {
+        printf("%s: Invalid slot %d.\n", __func__, slot);
+        return false;
+    }
+
     printf("odroid_system_emu_load_state: Loading state %d.\n", slot);
 
+    odroid_system_wait_for_save();
+
     odroid_display_show_hourglass();
     odroid_system_spi_lock_acquire(SPI_LOCK_SDCARD);
 
-    char *pathName = odroid_system_get_path(ODROID_PATH_SAVE_STATE, romPath);
-    bool success = (*loadState)(pathName);
+    char *pathName = odroid_system_get_path(ODROID_PATH_SAVE_STATE + slot, romPath);
+    FILE *fp = fopen(pathName, "rb");
+    state_header_t header;
+    bool success = false;
+
+    if (fp && state_read_header(fp, &header))
+    {
+        // Inflate the core's own state to RAM and let it load from there
+        state_section_t section;
+        void *packed = state_find_section(fp, STATE_SECTION_DATA, &section);
+        fclose(fp);
+
+        if (packed && state_file_reserve(section.size) && state_inflate(&section, packed, stateFile.data))
+        {
+            stateFile.size = section.size;
+            success = (*loadState)(STATE_RAM_FILE);
+        }
+        else
+        {
+            printf("%s: Corrupted state!\n", __func__);
+        }
+
+        free(packed);
+    }
+    else
+    {
+        // States written before the container are the core's raw format
+        if (fp) fclose(fp);
+        success = (*loadState)(pathName);
+    }
 
     odroid_system_spi_lock_release(SPI_LOCK_SDCARD);
 
@@ -270,6 +657,43 @@ bool odroid_system_emu_load_state(int slot)
     return success;
 }
 
+bool odroid_system_emu_read_thumbnail(int slot, uint16_t *buffer)
+{
+    if (!romPath || slot < 0 || slot >= ODROID_STATE_SLOTS)
+    {
+        return false;
+    }
+
+    odroid_system_wait_for_save();
+    odroid_system_spi_lock_acquire(SPI_LOCK_SDCARD);
+
+    char *pathName = odroid_system_get_path(ODROID_PATH_SAVE_STATE + slot, romPath);
+    FILE *fp = fopen(pathName, "rb");
+    state_header_t header;
+    bool success = false;
+
+    if (fp && state_read_header(fp, &header)
+        && header.thumbWidth == ODROID_THUMBNAIL_WIDTH
+        && header.thumbHeight == ODROID_THUMBNAIL_HEIGHT)
+    {
+        state_section_t section;
+        void *packed = state_find_section(fp, STATE_SECTION_THUMBNAIL, &section);
+
+        success = packed && section.size == ODROID_THUMBNAIL_WIDTH * ODROID_THUMBNAIL_HEIGHT * 2
+               && state_inflate(&section, packed, buffer);
+
+        free(packed);
+    }
+
+    if (fp) fclose(fp);
+
+    odroid_system_spi_lock_release(SPI_LOCK_SDCARD);
+
+    free(pathName);
+
+    return success;
+}
+
 bool odroid_system_emu_save_state(int slot)
 {
     if (!romPath || !saveState)
@@ -278,44 +702,48 @@ bool odroid_system_emu_save_state(int slot)
         return false;
     }
 
+    if (slot < 0 || slot >= ODROID_STATE_SLOTS)
+    {
+        printf("%s: Invalid slot %d.\n", __func__, slot);
+        return false;
+    }
+
     printf("odroid_system_emu_save_state: Saving state %d.\n", slot);
 
-    odroid_system_set_led(1);
-    odroid_display_show_hourglass();
-    odroid_system_spi_lock_acquire(SPI_LOCK_SDCARD);
+    // The previous state must be on the card before we reuse the buffer
+    xSemaphoreTake(saveDoneSem, portMAX_DELAY);
 
-    char *saveName = odroid_system_get_path(ODROID_PATH_SAVE_STATE, romPath);
-    char *backName = odroid_system_get_path(ODROID_PATH_SAVE_BACK, romPath);
-    char *tempName = odroid_system_get_path(ODROID_PATH_TEMP_FILE, romPath);
+    odroid_system_set_led(1);
 
-    bool success = false;
+    bool success = (*saveState)(STATE_RAM_FILE);
 
-    if ((*saveState)(tempName))
+    if (success)
     {
-        rename(saveName, backName);
+        saveHasThumbnail = odroid_display_get_thumbnail(saveThumbnail,
+            ODROID_THUMBNAIL_WIDTH, ODROID_THUMBNAIL_HEIGHT);
+        saveTaskPaths[0] = odroid_system_get_path(ODROID_PATH_SAVE_STATE + slot, romPath);
+        saveTaskPaths[1] = odroid_system_get_path(ODROID_PATH_SAVE_BACK + slot, romPath);
+        saveTaskPaths[2] = odroid_system_get_path(ODROID_PATH_TEMP_FILE, romPath);
 
-        if (rename(tempName, saveName) == 0)
+        if (saveTask)
+        {
+            xSemaphoreGive(saveTaskSem);
+        }
+        else
         {
-            unlink(backName);
-            success = true;
+            odroid_display_show_hourglass();
+            save_commit();
+            xSemaphoreGive(saveDoneSem);
         }
     }
-
-    unlink(tempName);
-
-    odroid_system_spi_lock_release(SPI_LOCK_SDCARD);
-    odroid_system_set_led(0);
-
-    if (!success)
+    else
     {
+        xSemaphoreGive(saveDoneSem);
+        odroid_system_set_led(0);
         printf("%s: Save failed!\n", __func__);
-        odroid_overlay_alert("Save failed");
+        odroid_overlay_notice("Save failed!");
     }
 
-    free(saveName);
-    free(backName);
-    free(tempName);
-
     return success;
 }
 
@@ -331,6 +759,9 @@ void odroid_system_switch_app(int app)
     odroid_display_clear(0);
     odroid_display_show_hourglass();
 
+    odroid_system_wait_for_save();
+    odroid_settings_commit();
+
     odroid_audio_terminate();
     odroid_sdcard_close();
 
@@ -398,6 +829,8 @@ void odroid_system_sleep()
 
     // Wait for button release
     odroid_input_wait_for_key(ODROID_INPUT_MENU, false);
+    odroid_system_wait_for_save();
+    odroid_settings_commit();
     odroid_audio_terminate();
     vTaskDelay(100);
     esp_deep_sleep_start();
@@ -420,6 +853,7 @@ static void odroid_system_monitor_task(void *arg)
         current = counters;
         counters.totalFrames = counters.fullFrames = 0;
         counters.skippedFrames = counters.busyTime = 0;
+        counters.skippedTime = 0;
         counters.resetTime = get_elapsed_time();
 
         tickTime = (counters.resetTime - current.resetTime);
@@ -431,8 +865,24 @@ static void odroid_system_monitor_task(void *arg)
         statistics.busyPercent = current.busyTime / tickTime * 100.f;
         statistics.skippedFPS = current.skippedFrames / (tickTime / 1000000.f);
         statistics.totalFPS = current.totalFrames / (tickTime / 1000000.f);
+        // Average cost of skipped and drawn frames, in us
+        statistics.skippedFrameTime = current.skippedFrames ? current.skippedTime / current.skippedFrames : 0;
+        statistics.fullFrameTime = (current.totalFrames > current.skippedFrames) ?
+            (current.busyTime - MIN(current.skippedTime, current.busyTime)) / (current.totalFrames - current.skippedFrames) : 0;
         // To do get the actual game refresh rate somehow
         statistics.emulatedSpeed = statistics.totalFPS / 60 * 100.f;
+        // Time from a debounced button change to the frame that latched it, in us
+        uint32_t latency, latencyMax;
+        odroid_input_get_latency(&latency, &latencyMax);
+        statistics.inputLatency = latency;
+        statistics.inputLatencyMax = latencyMax;
+        // Time from queueing a frame to the end of its transfer, in us
+        odroid_display_stats_t video;
+        odroid_display_get_stats(&video);
+        statistics.videoLatency = video.latency;
+        statistics.videoLatencyMax = video.latencyMax;
+        statistics.videoDropped = video.dropped;
+        statistics.videoClearTime = video.clearTime;
 
         statistics.freeMemoryInt = heap_caps_get_free_size(MALLOC_CAP_INTERNAL|MALLOC_CAP_8BIT);
         statistics.freeMemoryExt = heap_caps_get_free_size(MALLOC_CAP_SPIRAM|MALLOC_CAP_8BIT);
@@ -454,6 +904,9 @@ static void odroid_system_monitor_task(void *arg)
         }
     #endif
 
+        // Write back the settings once the user is done changing them
+        odroid_settings_commit_idle();
+
         // Applications should never stop polling input. If they do, they're probably unresponsive...
         if (statistics.lastTickTime > 0 && odroid_input_gamepad_last_polled() > 10000000)
         {
@@ -471,7 +924,7 @@ static void odroid_system_monitor_task(void *arg)
             odroid_system_set_led(led_state);
         }
 
-        printf("HEAP:%d+%d (%d+%d), BUSY:%.4f, FPS:%.4f (SKIP:%d, PART:%d, FULL:%d), BATTERY:%d\n",
+        printf("HEAP:%d+%d (%d+%d), BUSY:%.4f, FPS:%.4f (SKIP:%d, PART:%d, FULL:%d), FRAME:%d/%dus, INPUT:%d/%dus, VIDEO:%d/%dus (DROP:%d, CLEAR:%dus), BATTERY:%d\n",
             statistics.freeMemoryInt / 1024,
             statistics.freeMemoryExt / 1024,
             statistics.freeBlockInt / 1024,
@@ -481,6 +934,14 @@ static void odroid_system_monitor_task(void *arg)
             current.skippedFrames,
             current.totalFrames - current.fullFrames - current.skippedFrames,
             current.fullFrames,
+            statistics.skippedFrameTime,
+            statistics.fullFrameTime,
+            statistics.inputLatency,
+            statistics.inputLatencyMax,
+            statistics.videoLatency,
+            statistics.videoLatencyMax,
+            statistics.videoDropped,
+            statistics.videoClearTime,
             statistics.battery.millivolts);
 
         vTaskDelay(pdMS_TO_TICKS(1000));
@@ -491,7 +952,11 @@ static void odroid_system_monitor_task(void *arg)
 
 IRAM_ATTR void odroid_system_tick(uint skippedFrame, uint fullFrame, uint busyTime)
 {
-    if (skippedFrame) counters.skippedFrames++;
+    if (skippedFrame)
+    {
+        counters.skippedFrames++;
+        counters.skippedTime += busyTime;
+    }
     else if (fullFrame) counters.fullFrames++;
     counters.totalFrames++;
     counters.busyTime += busyTime;
@@ -506,13 +971,24 @@ runtime_stats_t odroid_system_get_stats()
 
 IRAM_ATTR void odroid_system_spi_lock_acquire(spi_lock_res_t owner)
 {
-    if (owner == spiMutexOwner)
+    // The display takes the lock per transaction and spi_task gives it back
+    // once the queue is empty, so it isn't tied to a task and doesn't nest
+    if (owner == SPI_LOCK_DISPLAY && owner == spiMutexOwner)
     {
         return;
     }
+
+    // The save task and the emulator both read/write the sd card, so the
+    // owner alone isn't enough to tell that we already hold the lock
+    if (owner == spiMutexOwner && spiMutexHolder == xTaskGetCurrentTaskHandle())
+    {
+        spiMutexDepth++;
+    }
     else if (xSemaphoreTake(spiMutex, 10000 / portTICK_RATE_MS) == pdPASS)
     {
         spiMutexOwner = owner;
+        spiMutexHolder = xTaskGetCurrentTaskHandle();
+        spiMutexDepth = 1;
     }
     else
     {
@@ -523,11 +999,24 @@ IRAM_ATTR void odroid_system_spi_lock_acquire(spi_lock_res_t owner)
 
 IRAM_ATTR void odroid_system_spi_lock_release(spi_lock_res_t owner)
 {
-    if (owner == spiMutexOwner || owner == SPI_LOCK_ANY)
+    if (owner == SPI_LOCK_ANY || (owner == SPI_LOCK_DISPLAY && owner == spiMutexOwner))
     {
-        xSemaphoreGive(spiMutex);
-        spiMutexOwner = SPI_LOCK_ANY;
+        spiMutexDepth = 0;
     }
+    else if (owner == spiMutexOwner && spiMutexHolder == xTaskGetCurrentTaskHandle())
+    {
+        // Only the outermost release gives the lock back
+        if (--spiMutexDepth > 0)
+            return;
+    }
+    else
+    {
+        return;
+    }
+
+    spiMutexOwner = SPI_LOCK_ANY;
+    spiMutexHolder = NULL;
+    xSemaphoreGive(spiMutex);
 }
 
 /* helpers */
@@ -8,6 +8,7 @@
 #include "odroid_audio.h"
 #include "odroid_display.h"
 #include "odroid_input.h"
+#include "odroid_movie.h"
 #include "odroid_overlay.h"
 #include "odroid_netplay.h"
 #include "odroid_sdcard.h"
@@ -46,6 +47,12 @@
 #define ODROID_BASE_PATH_TEMP      ODROID_BASE_PATH "/odroid/data" // temp
 #define ODROID_BASE_PATH_ROMART    ODROID_BASE_PATH "/romart"
 #define ODROID_BASE_PATH_CRC_CACHE ODROID_BASE_PATH "/odroid/cache/crc"
+#define ODROID_BASE_PATH_ROM_CACHE ODROID_BASE_PATH "/odroid/cache/rom"
+
+// Save states
+#define ODROID_STATE_SLOTS         4
+#define ODROID_THUMBNAIL_WIDTH     80
+#define ODROID_THUMBNAIL_HEIGHT    60
 
 extern int8_t speedupEnabled;
 
@@ -67,11 +74,16 @@ typedef enum
      ODROID_PATH_SAVE_STATE_2,
      ODROID_PATH_SAVE_STATE_3,
      ODROID_PATH_SAVE_BACK,
+     ODROID_PATH_SAVE_BACK_1,
+     ODROID_PATH_SAVE_BACK_2,
+     ODROID_PATH_SAVE_BACK_3,
      ODROID_PATH_SAVE_SRAM,
      ODROID_PATH_TEMP_FILE,
      ODROID_PATH_ROM_FILE,
      ODROID_PATH_ART_FILE,
      ODROID_PATH_CRC_CACHE,
+     ODROID_PATH_MOVIE,
+     ODROID_PATH_ROM_CACHE,
 } emu_path_type_t;
 
 typedef enum
@@ -94,6 +106,7 @@ typedef struct
      uint skippedFrames;
      uint fullFrames;
      uint busyTime;
+     uint skippedTime;
      uint realTime;
      uint resetTime;
 } runtime_counters_t;
@@ -106,6 +119,14 @@ typedef struct
      float totalFPS;
      float emulatedSpeed;
      float busyPercent;
+     uint skippedFrameTime;
+     uint fullFrameTime;
+     uint inputLatency;
+     uint inputLatencyMax;
+     uint videoLatency;
+     uint videoLatencyMax;
+     uint videoClearTime;
+     uint videoDropped;
      uint lastTickTime;
      uint freeMemoryInt;
      uint freeMemoryExt;
@@ -118,13 +139,14 @@ typedef struct
 void odroid_system_emu_init(state_handler_t load, state_handler_t save, netplay_callback_t netplay_cb);
 bool odroid_system_emu_save_state(int slot);
 bool odroid_system_emu_load_state(int slot);
+bool odroid_system_emu_read_thumbnail(int slot, uint16_t *buffer);
 void odroid_system_init(int app_id, int sampleRate);
 uint odroid_system_get_app_id();
 void odroid_system_set_app_id(int appId);
 uint odroid_system_get_game_id();
 uint odroid_system_get_start_action();
 const char* odroid_system_get_rom_path();
-char* odroid_system_get_path(emu_path_type_t type, char *romPath);
+char* odroid_system_get_path(emu_path_type_t type, const char *romPath);
 void odroid_system_panic(const char *reason);
 void odroid_system_unresponsive(const char *reason);
 void odroid_system_halt();
@@ -88,11 +88,15 @@ void run_to_vblank(bool draw)
     {
         odroid_video_frame *previousUpdate = (currentUpdate == &update1) ? &update2 : &update1;
 
-        fullFrame = odroid_display_queue_update(currentUpdate, previousUpdate) == SCREEN_UPDATE_FULL;
+        short result = odroid_display_queue_update(currentUpdate, previousUpdate);
+        fullFrame = result == SCREEN_UPDATE_FULL;
 
-        // swap buffers
-        currentUpdate = previousUpdate;
-        fb.ptr = currentUpdate->buffer;
+        // swap buffers, unless the frame was dropped and we can draw over it
+        if (result != SCREEN_UPDATE_DROPPED)
+        {
+            currentUpdate = previousUpdate;
+            fb.ptr = currentUpdate->buffer;
+        }
     }
 
     rtc_tick();
@@ -276,7 +280,7 @@ void app_main(void)
     while (true)
     {
         odroid_gamepad_state joystick;
-        odroid_input_gamepad_read(&joystick);
+        odroid_input_gamepad_latch(&joystick);
 
         if (joystick.values[ODROID_INPUT_MENU]) {
             odroid_overlay_game_menu();
@@ -291,7 +295,7 @@ void app_main(void)
         }
 
         uint startTime = get_elapsed_time();
-        bool drawFrame = !skipFrames;
+        bool drawFrame = !skipFrames || odroid_movie_checkpoint_due(false);
 
         pad_set(PAD_UP, joystick.values[ODROID_INPUT_UP]);
         pad_set(PAD_RIGHT, joystick.values[ODROID_INPUT_RIGHT]);
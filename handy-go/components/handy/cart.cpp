@@ -53,20 +53,26 @@
 
 #define CART_INC_COUNTER() {if(!mStrobe) mCounter = (mCounter + 1) & 0x07ff;}
 
-CCart::CCart(UBYTE *gamedata,ULONG gamesize)
+CCart::CCart(FILE *fp,ULONG gamesize)
 {
-   int headersize=0
+   int headersize=0;
    TRACE_CART1("CCart() called with %s",gamefile);
 
    mWriteEnableBank1=FALSE;
    mCartRAM=FALSE;
-   mCRC32=crc32_le(0,gamedata,gamesize);
+   mCRC32=0;
    mBank=bank0;
+   mFile=NULL;
+   mPageCache=NULL;
+
+   if(!fp) gamesize=0;
 
    // Open up the file
    if (gamesize > sizeof(LYNX_HEADER)) {
       // Checkout the header bytes
-      memcpy(&mFileHeader,gamedata,sizeof(LYNX_HEADER));
+      if(fread(&mFileHeader,sizeof(LYNX_HEADER),1,fp)!=1) {
+         memset(&mFileHeader,0,sizeof(LYNX_HEADER));
+      }
 
 #ifdef MSB_FIRST
       mFileHeader.page_size_bank0 = ((mFileHeader.page_size_bank0>>8) | (mFileHeader.page_size_bank0<<8));
@@ -83,8 +89,10 @@ CCart::CCart(UBYTE *gamedata,ULONG gamesize)
         strncpy((char*)&mFileHeader.cartname,"NO HEADER",32);
         strncpy((char*)&mFileHeader.manufname,"HANDY",16);
         mFileHeader.page_size_bank0=gamesize>>8;// Hard workaround...
+        fseek(fp,0,SEEK_SET);
       } else {
          headersize=sizeof(LYNX_HEADER);
+         mCRC32=crc32_le(mCRC32,(UBYTE*)&mFileHeader,headersize);
       }
 
       // As this is a cartridge boot unset the boot address
@@ -161,16 +169,6 @@ CCart::CCart(UBYTE *gamedata,ULONG gamesize)
    }
    TRACE_CART1("CCart() - Bank1 = $%06x",mMaskBank1);
 
-   // Make some space for the new carts
-
-   mCartBank0 = (UBYTE*) new UBYTE[mMaskBank0+1];
-   mCartBank1 = (UBYTE*) new UBYTE[mMaskBank1+1];
-   mCartBank0A = NULL;
-   mCartBank1A = NULL;
-
-   memset(mCartBank0, DEFAULT_CART_CONTENTS, mMaskBank0+1);
-   memset(mCartBank1, DEFAULT_CART_CONTENTS, mMaskBank1+1);
-
    // TODO: the following code to read the banks is not very nice .. should be reworked
    // TODO: actually its dangerous, if more than one bank is used ... (only homebrews)
    int cartsize = __max(0, int(gamesize - headersize));
@@ -179,10 +177,30 @@ CCart::CCart(UBYTE *gamedata,ULONG gamesize)
    if(bank0size==1) bank0size=0;// workaround ...
    if(bank1size==1) bank1size=0;// workaround ...
 
-   memcpy(mCartBank0, gamedata+(headersize), bank0size);
+   // Bank0 is read only, it can be left in the file and paged in when
+   // it is read. The banks are read straight from the file otherwise.
+   bool paged = gCartPaging && mMaskBank0 && bank0size && !CartGetAudin();
+
+   mCartBank0 = paged ? NULL : (UBYTE*) new UBYTE[mMaskBank0+1];
+   mCartBank1 = (UBYTE*) new UBYTE[mMaskBank1+1];
+   mCartBank0A = NULL;
+   mCartBank1A = NULL;
+
+   if(paged) {
+      mFile=fp;
+      mBank0Offset=headersize;
+      mBank0Size=bank0size;
+      mPageCache=(UBYTE*) new UBYTE[CART_PAGE_SLOTS*(mCountMask0+1)];
+      for(int loop=0;loop<CART_PAGE_SLOTS;loop++) mPageTag[loop]=~0U;
+      SkipFile(fp,bank0size);
+   } else {
+      memset(mCartBank0, DEFAULT_CART_CONTENTS, mMaskBank0+1);
+      ReadFile(fp,mCartBank0,bank0size);
+   }
    cartsize = __max(0, cartsize - bank0size);
 
-   memcpy(mCartBank1, gamedata+(headersize+bank0size), __min(cartsize, bank1size));
+   memset(mCartBank1, DEFAULT_CART_CONTENTS, mMaskBank1+1);
+   ReadFile(fp,mCartBank1,__min(cartsize, bank1size));
    cartsize = __max(0, cartsize - bank1size);
 
    if(CartGetAudin()){// TODO clean up code
@@ -191,14 +209,17 @@ CCart::CCart(UBYTE *gamedata,ULONG gamesize)
       memset(mCartBank0A, DEFAULT_CART_CONTENTS, mMaskBank0+1);
       memset(mCartBank1A, DEFAULT_CART_CONTENTS, mMaskBank1+1);
 
-      memcpy(mCartBank0A, gamedata+(headersize+bank0size+bank1size),
-         __min(cartsize, bank0size));
+      ReadFile(fp,mCartBank0A,__min(cartsize, bank0size));
       cartsize = __max(0, cartsize - bank0size);
 
-      memcpy(mCartBank1A, gamedata+(headersize+bank0size+bank1size+bank0size),
-            __min(cartsize, bank1size));
+      ReadFile(fp,mCartBank1A,__min(cartsize, bank1size));
       cartsize = __max(0, cartsize - bank1size);
    }
+
+   // The CRC still covers the whole file, including anything past the banks
+   SkipFile(fp,gamesize);
+
+   if(fp && !paged) fclose(fp);
 }
 
 CCart::~CCart()
@@ -208,6 +229,53 @@ CCart::~CCart()
    if (mCartBank1) delete[] mCartBank1;
    if (mCartBank0A) delete[] mCartBank0A;
    if (mCartBank1A) delete[] mCartBank1A;
+   if (mPageCache) delete[] mPageCache;
+   if (mFile) fclose(mFile);
+}
+
+void CCart::ReadFile(FILE *fp,UBYTE *dest,int size)
+{
+   if(size<=0) return;
+
+   int count=fread(dest,1,size,fp);
+   if(count!=size) fprintf(stderr, "Invalid Cart (filesize).\n");
+   if(count>0) mCRC32=crc32_le(mCRC32,dest,count);
+}
+
+void CCart::SkipFile(FILE *fp,int size)
+{
+   UBYTE buffer[512];
+
+   while(size>0) {
+      int count=fread(buffer,1,__min(size,(int)sizeof(buffer)),fp);
+      if(count<=0) break;
+      mCRC32=crc32_le(mCRC32,buffer,count);
+      size-=count;
+   }
+}
+
+UBYTE CCart::PeekPaged0(ULONG address)
+{
+   ULONG page=address>>mShiftCount0;
+   ULONG slot=page&(CART_PAGE_SLOTS-1);
+   ULONG pagesize=mCountMask0+1;
+   UBYTE *data=mPageCache+slot*pagesize;
+
+   if(mPageTag[slot]!=page) {
+      ULONG offset=page*pagesize;
+
+      memset(data,DEFAULT_CART_CONTENTS,pagesize);
+
+      if(offset<mBank0Size) {
+         if(gCartPagingLock) gCartPagingLock(TRUE);
+         fseek(mFile,mBank0Offset+offset,SEEK_SET);
+         fread(data,1,__min(pagesize,mBank0Size-offset),mFile);
+         if(gCartPagingLock) gCartPagingLock(FALSE);
+      }
+      mPageTag[slot]=page;
+   }
+
+   return data[address&mCountMask0];
 }
 
 void CCart::Reset(void)
@@ -310,6 +378,7 @@ inline void CCart::Poke(ULONG addr, UBYTE data)
 inline UBYTE CCart::Peek(ULONG addr)
 {
    if(mBank==bank0) {
+      if(!mCartBank0) return PeekPaged0(addr&mMaskBank0);
       return(mCartBank0[addr&mMaskBank0]);
    } else {
       return(mCartBank1[addr&mMaskBank1]);
@@ -347,7 +416,7 @@ void CCart::Poke1A(UBYTE data)
 UBYTE CCart::Peek0(void)
 {
    ULONG address=(mShifter<<mShiftCount0)+(mCounter&mCountMask0);
-   UBYTE data=mCartBank0[address&mMaskBank0];
+   UBYTE data=mCartBank0?mCartBank0[address&mMaskBank0]:PeekPaged0(address&mMaskBank0);
 
    CART_INC_COUNTER();
 
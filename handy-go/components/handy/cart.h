@@ -80,6 +80,9 @@
 
 #define DEFAULT_CART_CONTENTS	0xFF
 
+// Number of bank0 pages kept in memory when the cart is paged from the file
+#define CART_PAGE_SLOTS	16
+
 enum CTYPE {UNUSED,C64K,C128K,C256K,C512K,C1024K};
 
 #define CART_NO_ROTATE		0
@@ -107,7 +110,7 @@ class CCart : public CLynxBase
    // Function members
 
    public:
-      CCart(UBYTE *gamedata,ULONG gamesize);
+      CCart(FILE *fp,ULONG gamesize);
       ~CCart();
 
    public:
@@ -149,6 +152,11 @@ class CCart : public CLynxBase
       void SetShifterValue(UBYTE a){mShifter=a; mCounter=0;}; // for fake bios
       inline ULONG GetCounterValue(void) {return mCounter;}; // for eeprom
 
+   private:
+      void	ReadFile(FILE *fp,UBYTE *dest,int size);
+      void	SkipFile(FILE *fp,int size);
+      UBYTE	PeekPaged0(ULONG address);
+
       // Data members
 
    public:
@@ -165,6 +173,12 @@ class CCart : public CLynxBase
       UBYTE	*mCartBank0A;
       UBYTE	*mCartBank1A;
 
+      FILE	*mFile;
+      ULONG	mBank0Offset;
+      ULONG	mBank0Size;
+      UBYTE	*mPageCache;
+      ULONG	mPageTag[CART_PAGE_SLOTS];
+
       LYNX_HEADER mFileHeader;
       ULONG	      mCRC32;
 
@@ -52,6 +52,7 @@
 #include "system.h"
 #include "susie.h"
 #include "lynxdef.h"
+#include "susie_pixel_loop.h"
 
 CSusie::CSusie(CSystem& parent)
    :mSystem(parent)
@@ -341,6 +342,29 @@ bool CSusie::ContextLoad(LSS_FILE *fp)
    return 1;
 }
 
+#define LINE_RENDERERS(type,collide) \
+   { &CSusie::RenderLine<type,1,collide>, &CSusie::RenderLine<type,2,collide>, \
+     &CSusie::RenderLine<type,3,collide>, &CSusie::RenderLine<type,4,collide> }
+
+CSusie::TLineRenderer CSusie::SelectLineRenderer(void)
+{
+   // Indexed by sprite type, collision enabled & bits per pixel
+   static const TLineRenderer renderers[8][2][4] = {
+      { LINE_RENDERERS(sprite_background_shadow,false),     LINE_RENDERERS(sprite_background_shadow,true) },
+      { LINE_RENDERERS(sprite_background_noncollide,false), LINE_RENDERERS(sprite_background_noncollide,false) },
+      { LINE_RENDERERS(sprite_boundary_shadow,false),       LINE_RENDERERS(sprite_boundary_shadow,true) },
+      { LINE_RENDERERS(sprite_boundary,false),              LINE_RENDERERS(sprite_boundary,true) },
+      { LINE_RENDERERS(sprite_normal,false),                LINE_RENDERERS(sprite_normal,true) },
+      { LINE_RENDERERS(sprite_noncollide,false),            LINE_RENDERERS(sprite_noncollide,false) },
+      { LINE_RENDERERS(sprite_xor_shadow,false),            LINE_RENDERERS(sprite_xor_shadow,true) },
+      { LINE_RENDERERS(sprite_shadow,false),                LINE_RENDERERS(sprite_shadow,true) },
+   };
+
+   int collide=(!mSPRCOLL_Collide && !mSPRSYS_NoCollide) ? 1 : 0;
+
+   return renderers[mSPRCTL0_Type&7][collide][(mSPRCTL0_PixelBits-1)&3];
+}
+
 ULONG CSusie::PaintSprites(void)
 {
    int	sprcount=0;
@@ -664,15 +688,14 @@ ULONG CSusie::PaintSprites(void)
             TRACE_SUSIE1("PaintSprites() Render status %d",render);
 
             int pixel_height=0;
-            int pixel_width=0;
-            static int pixel=0;
             int hoff=0,voff=0;
-            int hloop=0,vloop=0;
-            bool onscreen=0;
+            int vloop=0;
             static int vquadoff=0;
             static int hquadoff=0;
 
             if(render) { //  && gRenderFrame
+               TLineRenderer render_line=SelectLineRenderer();
+
                // Set the vertical position & offset
                voff=(SWORD)mVPOSSTRT.Word-screen_v_start;
 
@@ -738,194 +761,8 @@ ULONG CSusie::PaintSprites(void)
 
                         // Initialise our line
                         LineInit(voff);
-                        onscreen=FALSE;
-
-                        ULONG pixel = mLinePixel; // Much faster
-                        switch(mSPRCTL0_Type)
-                        {
-                              case sprite_background_shadow:
-                                 #undef PROCESS_PIXEL
-                                 #define PROCESS_PIXEL \
-                                 WritePixel(hoff,pixel); \
-                                 if(!mSPRCOLL_Collide && !mSPRSYS_NoCollide && pixel!=0x0e) \
-                                 { \
-                                    WriteCollision(hoff,mSPRCOLL_Number); \
-                                 }
-
-                                 #undef EndWhile
-                                 #undef LoopContinue
-                                 #define EndWhile EndWhile01b
-                                 #define LoopContinue LoopContinue01b
-                                 #include "susie_pixel_loop.h"
-                                 break;
-                              case sprite_background_noncollide:
-                                 #undef PROCESS_PIXEL
-                                 #define PROCESS_PIXEL WritePixel(hoff,pixel);
-
-                                 #undef EndWhile
-                                 #undef LoopContinue
-                                 #define EndWhile EndWhile02b
-                                 #define LoopContinue LoopContinue02b
-                                 #include "susie_pixel_loop.h"
-                                 break;
-                              case sprite_noncollide:
-                                 #undef PROCESS_PIXEL
-                                 #define PROCESS_PIXEL if(pixel!=0x00) WritePixel(hoff,pixel);
-
-                                 #undef EndWhile
-                                 #undef LoopContinue
-                                 #define EndWhile EndWhile03b
-                                 #define LoopContinue LoopContinue03b
-                                 #include "susie_pixel_loop.h"
-                                 break;
-                              case sprite_boundary:
-                                 #undef PROCESS_PIXEL
-                                 #define PROCESS_PIXEL \
-                                 if(pixel!=0x00 && pixel!=0x0f) \
-                                 { \
-                                    WritePixel(hoff,pixel); \
-                                 } \
-                                 if(pixel!=0x00) \
-                                 { \
-                                    if(!mSPRCOLL_Collide && !mSPRSYS_NoCollide) \
-                                    { \
-                                       ULONG collision=ReadCollision(hoff); \
-                                       if(collision>mCollision) \
-                                       { \
-                                          mCollision=collision; \
-                                       } \
-                                       { \
-                                          WriteCollision(hoff,mSPRCOLL_Number); \
-                                       } \
-                                    } \
-                                 }
-
-                                 #undef EndWhile
-                                 #undef LoopContinue
-                                 #define EndWhile EndWhile04b
-                                 #define LoopContinue LoopContinue04b
-                                 #include "susie_pixel_loop.h"
-                                 break;
-                              case sprite_normal:
-                                 #undef PROCESS_PIXEL
-                                 #define PROCESS_PIXEL \
-                                 if(pixel!=0x00) \
-                                 { \
-                                    WritePixel(hoff,pixel); \
-                                    if(!mSPRCOLL_Collide && !mSPRSYS_NoCollide) \
-                                    { \
-                                       ULONG collision=ReadCollision(hoff); \
-                                       if(collision>mCollision) \
-                                       { \
-                                          mCollision=collision; \
-                                       } \
-                                       { \
-                                          WriteCollision(hoff,mSPRCOLL_Number); \
-                                       } \
-                                    } \
-                                 }
-
-                                 #undef EndWhile
-                                 #undef LoopContinue
-                                 #define EndWhile EndWhile05b
-                                 #define LoopContinue LoopContinue05b
-                                 #include "susie_pixel_loop.h"
-                                 break;
-                              case sprite_boundary_shadow:
-                                 #undef PROCESS_PIXEL
-                                 #define PROCESS_PIXEL \
-                                 if(pixel!=0x00 && pixel!=0x0e && pixel!=0x0f) \
-                                 { \
-                                    WritePixel(hoff,pixel); \
-                                 } \
-                                 if(pixel!=0x00 && pixel!=0x0e) \
-                                 { \
-                                    if(!mSPRCOLL_Collide && !mSPRSYS_NoCollide) \
-                                    { \
-                                       ULONG collision=ReadCollision(hoff); \
-                                       if(collision>mCollision) \
-                                       { \
-                                          mCollision=collision; \
-                                       } \
-                                       { \
-                                          WriteCollision(hoff,mSPRCOLL_Number); \
-                                       } \
-                                    } \
-                                 }
-
-                                 #undef EndWhile
-                                 #undef LoopContinue
-                                 #define EndWhile EndWhile06b
-                                 #define LoopContinue LoopContinue06b
-                                 #include "susie_pixel_loop.h"
-                                 break;
-                              case sprite_shadow:
-                                 #undef PROCESS_PIXEL
-                                 #define PROCESS_PIXEL \
-                                 if(pixel!=0x00) \
-                                 { \
-                                    WritePixel(hoff,pixel); \
-                                 } \
-                                 if(pixel!=0x00 && pixel!=0x0e) \
-                                 { \
-                                    if(!mSPRCOLL_Collide && !mSPRSYS_NoCollide) \
-                                    { \
-                                       ULONG collision=ReadCollision(hoff); \
-                                       if(collision>mCollision) \
-                                       { \
-                                          mCollision=collision; \
-                                       } \
-                                       { \
-                                          WriteCollision(hoff,mSPRCOLL_Number); \
-                                       } \
-                                    } \
-                                 }
-
-                                 #undef EndWhile
-                                 #undef LoopContinue
-                                 #define EndWhile EndWhile07b
-                                 #define LoopContinue LoopContinue07b
-                                 #include "susie_pixel_loop.h"
-                                 break;
-                              case sprite_xor_shadow:
-                                 #undef PROCESS_PIXEL
-                                 #define PROCESS_PIXEL \
-                                 if(pixel!=0x00) \
-                                 { \
-                                    WritePixel(hoff,ReadPixel(hoff)^pixel); \
-                                 } \
-                                 if(pixel!=0x00 && pixel!=0x0e) \
-                                 { \
-                                    if(!mSPRCOLL_Collide && !mSPRSYS_NoCollide && pixel!=0x0e) \
-                                    { \
-                                       ULONG collision=ReadCollision(hoff); \
-                                       if(collision>mCollision) \
-                                       { \
-                                          mCollision=collision; \
-                                       } \
-                                       { \
-                                          WriteCollision(hoff,mSPRCOLL_Number); \
-                                       } \
-                                    } \
-                                 }
-
-                                 #undef EndWhile
-                                 #undef LoopContinue
-                                 #define EndWhile EndWhile08b
-                                 #define LoopContinue LoopContinue08b
-                                 #include "susie_pixel_loop.h"
-                                 break;
-                              default:
-                                 #undef PROCESS_PIXEL
-                                 #define PROCESS_PIXEL
-
-                                 #undef EndWhile
-                                 #undef LoopContinue
-                                 #define EndWhile EndWhile09b
-                                 #define LoopContinue LoopContinue09b
-                                 #include "susie_pixel_loop.h"
-                                 break;
-                        }
+
+                        if((this->*render_line)(hoff,hsign)) everonscreen=TRUE;
                      }
                      voff+=vsign;
 
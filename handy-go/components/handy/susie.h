@@ -491,6 +491,21 @@ class CSusie : public CLynxBase
       return (hoff&1) ? (data&0xf) : (data>>4);
    }
 
+   // Line renderers, see susie_pixel_loop.h
+   typedef bool (CSusie::*TLineRenderer)(int hoff,int hsign);
+
+   TLineRenderer SelectLineRenderer(void);
+
+   template<int TYPE,int BPP,bool COLLIDE> bool RenderLine(int hoff,int hsign);
+   template<int TYPE,bool COLLIDE> inline void ProcessPixel(ULONG hoff,ULONG pixel);
+   template<int TYPE,bool COLLIDE> inline void ProcessSpan(ULONG hoff,ULONG count,ULONG pixel);
+   template<int TYPE> inline bool PixelDraws(ULONG pixel);
+   template<int TYPE> inline bool PixelCollides(ULONG pixel);
+
+   inline void FillNibbles(ULONG base,ULONG hoff,ULONG count,ULONG value);
+   inline void XorNibbles(ULONG base,ULONG hoff,ULONG count,ULONG value);
+   inline ULONG MaxNibble(ULONG base,ULONG hoff,ULONG count);
+
    private:
       CSystem&		mSystem;
 
@@ -1,7 +1,155 @@
+//
+// Sprite line renderers for CSusie::PaintSprites()
+//
+// One instance is generated per sprite type, pixel depth and collision state
+// so the per pixel type checks and bit fetches are resolved at compile time.
+// Packed runs and horizontally scaled pixels are drawn as clipped spans.
+//
+
+inline void CSusie::FillNibbles(ULONG base,ULONG hoff,ULONG count,ULONG value)
+{
+   ULONG addr=base+(hoff>>1);
+
+   if(hoff&1) {
+      RAM_POKE(addr,(RAM_PEEK(addr)&0xf0)|value);
+      addr++;
+      count--;
+   }
+   if(count>=2) {
+      memset(&mRamPointer[addr],value*0x11,count>>1);
+      addr+=count>>1;
+   }
+   if(count&1) {
+      RAM_POKE(addr,(RAM_PEEK(addr)&0x0f)|(value<<4));
+   }
+}
+
+inline void CSusie::XorNibbles(ULONG base,ULONG hoff,ULONG count,ULONG value)
+{
+   ULONG addr=base+(hoff>>1);
+
+   if(hoff&1) {
+      mRamPointer[addr++]^=value;
+      count--;
+   }
+   for(;count>=2;count-=2) {
+      mRamPointer[addr++]^=value*0x11;
+   }
+   if(count&1) {
+      mRamPointer[addr]^=value<<4;
+   }
+}
+
+inline ULONG CSusie::MaxNibble(ULONG base,ULONG hoff,ULONG count)
+{
+   ULONG result=0;
+
+   for(ULONG loop=hoff;loop<hoff+count;loop++) {
+      UBYTE data=RAM_PEEK(base+(loop>>1));
+      ULONG value=(loop&1) ? (data&0xf) : (data>>4);
+      if(value>result) result=value;
+   }
+   return result;
+}
+
+template<int TYPE>
+inline bool CSusie::PixelDraws(ULONG pixel)
+{
+   switch(TYPE) {
+      case sprite_background_shadow:
+      case sprite_background_noncollide:
+         return true;
+      case sprite_boundary:
+         return pixel!=0x00 && pixel!=0x0f;
+      case sprite_boundary_shadow:
+         return pixel!=0x00 && pixel!=0x0e && pixel!=0x0f;
+      default:
+         return pixel!=0x00;
+   }
+}
+
+template<int TYPE>
+inline bool CSusie::PixelCollides(ULONG pixel)
+{
+   switch(TYPE) {
+      case sprite_background_noncollide:
+      case sprite_noncollide:
+         return false;
+      case sprite_background_shadow:
+         return pixel!=0x0e;
+      case sprite_boundary:
+      case sprite_normal:
+         return pixel!=0x00;
+      default:
+         return pixel!=0x00 && pixel!=0x0e;
+   }
+}
+
+template<int TYPE,bool COLLIDE>
+inline void CSusie::ProcessPixel(ULONG hoff,ULONG pixel)
+{
+   if(PixelDraws<TYPE>(pixel)) {
+      if(TYPE==sprite_xor_shadow) WritePixel(hoff,ReadPixel(hoff)^pixel);
+      else WritePixel(hoff,pixel);
+   }
+
+   if(COLLIDE && PixelCollides<TYPE>(pixel)) {
+      // Background sprites don't report collisions, they only set the buffer
+      if(TYPE!=sprite_background_shadow) {
+         ULONG collision=ReadCollision(hoff);
+         if(collision>(ULONG)mCollision) {
+            mCollision=collision;
+         }
+      }
+      WriteCollision(hoff,mSPRCOLL_Number);
+   }
+}
+
+// Same as ProcessPixel for count pixels from hoff, left to right
+template<int TYPE,bool COLLIDE>
+inline void CSusie::ProcessSpan(ULONG hoff,ULONG count,ULONG pixel)
+{
+   if(PixelDraws<TYPE>(pixel)) {
+      if(TYPE==sprite_xor_shadow) {
+         XorNibbles(mLineBaseAddress,hoff,count,pixel);
+         mCycles+=count*3*SPR_RDWR_CYC;
+      } else {
+         FillNibbles(mLineBaseAddress,hoff,count,pixel);
+         mCycles+=count*2*SPR_RDWR_CYC;
+      }
+   }
+
+   if(COLLIDE && PixelCollides<TYPE>(pixel)) {
+      if(TYPE!=sprite_background_shadow) {
+         ULONG collision=MaxNibble(mLineCollisionAddress,hoff,count);
+         if(collision>(ULONG)mCollision) {
+            mCollision=collision;
+         }
+         mCycles+=count*SPR_RDWR_CYC;
+      }
+      FillNibbles(mLineCollisionAddress,hoff,count,mSPRCOLL_Number);
+      mCycles+=count*2*SPR_RDWR_CYC;
+   }
+}
+
+// Decode and draw one destination line, returns TRUE if anything was on screen
+template<int TYPE,int BPP,bool COLLIDE>
+bool CSusie::RenderLine(int hoff,int hsign)
+{
+   ULONG pixel=mLinePixel;
+   bool onscreen=FALSE;
+
+   // Spans write the screen before the collision buffer, which is only the
+   // same as the pixel order if the two lines don't overlap in memory
+   ULONG distance=(mLineBaseAddress>mLineCollisionAddress) ?
+      mLineBaseAddress-mLineCollisionAddress : mLineCollisionAddress-mLineBaseAddress;
+   bool spans=!COLLIDE || distance>=SCREEN_WIDTH/2;
+
    // Now render an individual destination line
    while(true)
    {
          ULONG tmp;
+         ULONG run=1;
 
          if(!mLineRepeatCount)
          {
@@ -18,7 +166,7 @@
                case line_abs_literal:
                   // This means end of line for us
                   mLinePixel=LINE_END;
-                  goto EndWhile;
+                  return onscreen;
                case line_literal:
                   MY_GET_BITS(mLineRepeatCount,4)
                   mLineRepeatCount++;
@@ -33,11 +181,11 @@
                   {
                      mLinePixel=LINE_END;
                      mLineRepeatCount++;
-                     goto EndWhile;
+                     return onscreen;
                   }
                   else
                   {
-                     MY_GET_BITS(tmp,mSPRCTL0_PixelBits)
+                     MY_GET_BITS(tmp,BPP)
                      pixel=mPenIndex[tmp];
                   }
                   mLineRepeatCount++;
@@ -48,33 +196,33 @@
             }
 
          }
-      /*
-         if(pixel==LINE_END)
-         {
-               printf("ERROR!\n");
-               goto EndWhile;
-         }
-      */
+
             mLineRepeatCount--;
 
             switch(mLineType)
             {
                case line_abs_literal:
-                  MY_GET_BITS(pixel,mSPRCTL0_PixelBits)
+                  MY_GET_BITS(pixel,BPP)
                   // Check the special case of a zero in the last pixel
                   if(!mLineRepeatCount && !pixel)
                   {
                      mLinePixel=LINE_END;
-                     goto EndWhile;
+                     return onscreen;
                   }
                   else
                      pixel=mPenIndex[pixel];
                   break;
                case line_literal:
-                  MY_GET_BITS(tmp,mSPRCTL0_PixelBits)
+                  MY_GET_BITS(tmp,BPP)
                   pixel=mPenIndex[tmp];
                   break;
                case line_packed:
+                  // The rest of the packet is the same pen, draw it in one go
+                  if(spans)
+                  {
+                     run+=mLineRepeatCount;
+                     mLineRepeatCount=0;
+                  }
                   break;
                default:
                   pixel=0;
@@ -84,26 +232,60 @@
    LoopContinue:;
 
       // This is allowed to update every pixel
-      mHSIZACUM.Word+=mSPRHSIZ.Word;
-      pixel_width=mHSIZACUM.Byte.High;
-      mHSIZACUM.Byte.High=0;
+      int pixel_width=0;
+      for(ULONG loop=0;loop<run;loop++)
+      {
+         mHSIZACUM.Word+=mSPRHSIZ.Word;
+         pixel_width+=mHSIZACUM.Byte.High;
+         mHSIZACUM.Byte.High=0;
+      }
 
-      for(int hloop=0;hloop<pixel_width;hloop++)
+      if(!spans || pixel_width<2)
       {
-         // Draw if onscreen but break loop on transition to offscreen
-         if(hoff>=0 && hoff<SCREEN_WIDTH)
+         for(int hloop=0;hloop<pixel_width;hloop++)
          {
-            //ProcessPixel(hoff,pixel);
-            PROCESS_PIXEL
-            onscreen=TRUE;
-            everonscreen=TRUE;
+            // Draw if onscreen but break loop on transition to offscreen
+            if(hoff>=0 && hoff<SCREEN_WIDTH)
+            {
+               ProcessPixel<TYPE,COLLIDE>(hoff,pixel);
+               onscreen=TRUE;
+            }
+            else
+            {
+               if(onscreen) break;
+            }
+            hoff += hsign;
          }
-         else
+         continue;
+      }
+
+      // Clipped span, same rules as above: skip until the screen is reached
+      // then stop (without moving) on the first pixel past its edge
+      if(hoff<0 || hoff>=SCREEN_WIDTH)
+      {
+         if(onscreen) continue;
+
+         int lead=(hsign>0) ? -hoff : hoff-(SCREEN_WIDTH-1);
+         if(lead<0) lead=0;
+         if(lead>pixel_width) lead=pixel_width;
+         hoff+=lead*hsign;
+         pixel_width-=lead;
+
+         if(hoff<0 || hoff>=SCREEN_WIDTH)
          {
-            if(onscreen) break;
+            hoff+=pixel_width*hsign;
+            continue;
          }
-         hoff += hsign;
+      }
+
+      if(pixel_width)
+      {
+         int room=(hsign>0) ? SCREEN_WIDTH-hoff : hoff+1;
+         int count=(pixel_width<room) ? pixel_width : room;
+
+         ProcessSpan<TYPE,COLLIDE>((hsign>0) ? hoff : hoff-count+1,count,pixel);
+         onscreen=TRUE;
+         hoff+=count*hsign;
       }
    }
-mLinePixel = pixel;
-EndWhile:;
+}
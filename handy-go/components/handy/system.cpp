@@ -83,6 +83,9 @@ ULONG   gAudioBufferPointer=0;
 ULONG   gAudioLastUpdateCycle=0;
 UBYTE   *gPrimaryFrameBuffer=NULL;
 
+ULONG   gCartPaging=FALSE;
+void    (*gCartPagingLock)(bool locked)=NULL;
+
 
 extern void lynx_decrypt(unsigned char * result, const unsigned char * encrypted, const int length);
 
@@ -134,7 +137,8 @@ CSystem::CSystem(const char* gamefile, long displayformat, long samplerate)
    ULONG filesize=0;
 
    mFileType=HANDY_FILETYPE_ILLEGAL;
-   // Open the file and load the file
+   // Open the file, only the start is needed to tell what it is. Carts
+   // read their banks straight from the file so it's never loaded twice.
    FILE *fp;
 
    // Open the cartridge file for reading
@@ -143,13 +147,6 @@ CSystem::CSystem(const char* gamefile, long displayformat, long samplerate)
       fseek(fp,0,SEEK_END);
       filesize=ftell(fp);
       fseek(fp,0,SEEK_SET);
-      filememory=(UBYTE*) new UBYTE[filesize];
-
-      if(fread(filememory, 1, filesize,fp)!=filesize) {
-         fprintf(stderr, "Invalid Cart (filesize).\n");
-      }
-
-      fclose(fp);
    } else {
       fprintf(stderr, "Invalid Cart.\n");
       // abort();
@@ -158,7 +155,11 @@ CSystem::CSystem(const char* gamefile, long displayformat, long samplerate)
    // Now try and determine the filetype we have opened
    if(filesize) {
       char clip[11];
-      memcpy(clip,filememory,11);
+      memset(clip,0,11);
+      if(fread(clip,1,11,fp)!=__min(filesize,11U)) {
+         fprintf(stderr, "Invalid Cart (filesize).\n");
+      }
+      fseek(fp,0,SEEK_SET);
       clip[4]=0;
       clip[10]=0;
 
@@ -180,21 +181,29 @@ CSystem::CSystem(const char* gamefile, long displayformat, long samplerate)
    switch(mFileType) {
       case HANDY_FILETYPE_RAW:
       case HANDY_FILETYPE_LNX:
-         mCart = new CCart(filememory,filesize);
+         // The cart takes the file over
+         mCart = new CCart(fp,filesize);
          mRam = new CRam(0,0);
+         fp=NULL;
          break;
       case HANDY_FILETYPE_HOMEBREW:
-         mCart = new CCart(0,0);
+         // Homebrews are at most 64K and are copied to RAM
+         filememory=(UBYTE*) new UBYTE[filesize];
+         if(fread(filememory, 1, filesize,fp)!=filesize) {
+            fprintf(stderr, "Invalid Cart (filesize).\n");
+         }
+         mCart = new CCart(NULL,0);
          mRam = new CRam(filememory,filesize);
          break;
       case HANDY_FILETYPE_ILLEGAL:
       default:
          // abort() ?
-         mCart = new CCart(0,0);
+         mCart = new CCart(NULL,0);
          mRam = new CRam(0,0);
          break;
    }
 
+   if(fp) fclose(fp);
    if(filememory) delete[] filememory;
 
    memset(mBiosRom, 0x88, sizeof(mBiosRom));
@@ -123,6 +123,9 @@ extern ULONG    gAudioBufferPointer;
 extern ULONG    gAudioLastUpdateCycle;
 extern UBYTE    *gPrimaryFrameBuffer;
 
+extern ULONG    gCartPaging;
+extern void     (*gCartPagingLock)(bool locked);
+
 // typedef struct lssfile
 // {
 //    UBYTE *memptr;
@@ -234,15 +237,25 @@ class CSystem : public CSystemBase
 
             mCpu->Update();
 
-         #ifdef _LYNXDBG
-                  // Check breakpoint
-                  static ULONG lastcycle=0;
-                  if(lastcycle<mCycleCountBreakpoint && gSystemCycleCount>=mCycleCountBreakpoint) gBreakpointHit=TRUE;
-                  lastcycle=gSystemCycleCount;
+#ifdef _LYNXDBG
+            // Check breakpoint
+            static ULONG lastcycle=0;
+            if(lastcycle<mCycleCountBreakpoint && gSystemCycleCount>=mCycleCountBreakpoint) gBreakpointHit=TRUE;
+            lastcycle=gSystemCycleCount;
 
-                  // Check single step mode
-                  if(gSingleStepMode) gBreakpointHit=TRUE;
-         #endif
+            // Check single step mode
+            if(gSingleStepMode) gBreakpointHit=TRUE;
+#else
+            //
+            // Run the CPU in one batch up to the next timer event. It stops
+            // early if it goes to sleep or if a timer read updated Mikie
+            // and that update ended the frame.
+            //
+            while(gSystemCycleCount<gNextTimerEvent && !gSystemCPUSleep && !gEndOfFrame)
+            {
+               mCpu->Update();
+            }
+#endif
 
             if(gSystemCPUSleep)
             {
@@ -1,5 +1,6 @@
 extern "C" {
 #include <freertos/FreeRTOS.h>
+#include <esp_heap_caps.h>
 #include <odroid_system.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -25,6 +26,15 @@ static CSystem *lynx = NULL;
 // --- MAIN
 
 
+static void cart_paging_lock(bool locked)
+{
+    if (locked)
+        odroid_system_spi_lock_acquire(SPI_LOCK_SDCARD);
+    else
+        odroid_system_spi_lock_release(SPI_LOCK_SDCARD);
+}
+
+
 static bool save_state(char *pathName)
 {
     bool ret = false;
@@ -73,9 +83,21 @@ extern "C" void app_main(void)
 
     const char *romFile = odroid_system_get_rom_path();
 
+    // Page the cart from the sd card instead of loading it, saves up to 512KB
+    gCartPaging = odroid_settings_app_int32_get("CartPaging", 0);
+    gCartPagingLock = &cart_paging_lock;
+
+    // Same measure as runtime_stats_t.freeBlockExt
+    uint blockBefore = heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM|MALLOC_CAP_8BIT);
+
     // Init emulator
     lynx = new CSystem(romFile, MIKIE_PIXEL_FORMAT_16BPP_565_BE, AUDIO_SAMPLE_RATE);
 
+    printf("app_main: Cart loaded (paging: %d), freeBlockExt: %dKB -> %dKB, lowest free: %dKB\n",
+        gCartPaging, blockBefore / 1024,
+        heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM|MALLOC_CAP_8BIT) / 1024,
+        heap_caps_get_minimum_free_size(MALLOC_CAP_SPIRAM|MALLOC_CAP_8BIT) / 1024);
+
     gPrimaryFrameBuffer = (UBYTE*)currentUpdate->buffer;
     gAudioBuffer = (SWORD*)&audioBuffer;
     gAudioEnabled = 1;
@@ -94,7 +116,7 @@ extern "C" void app_main(void)
     // Start emulation
     while (1)
     {
-        odroid_input_gamepad_read(&joystick);
+        odroid_input_gamepad_latch(&joystick);
 
         if (joystick.values[ODROID_INPUT_MENU]) {
             odroid_overlay_game_menu();
@@ -108,7 +130,7 @@ extern "C" void app_main(void)
         }
 
         uint startTime = get_elapsed_time();
-        bool drawFrame = !skipFrames;
+        bool drawFrame = !skipFrames || odroid_movie_checkpoint_due(false);
 
         ULONG buttons = 0;
 
@@ -127,10 +149,16 @@ extern "C" void app_main(void)
 
         if (drawFrame)
         {
-            fullFrame = odroid_display_queue_update(currentUpdate, previousUpdate) == SCREEN_UPDATE_FULL;
-            previousUpdate = currentUpdate;
-            currentUpdate = (currentUpdate == &update1) ? &update2 : &update1;
-            gPrimaryFrameBuffer = (UBYTE*)currentUpdate->buffer;
+            short result = odroid_display_queue_update(currentUpdate, previousUpdate);
+            fullFrame = result == SCREEN_UPDATE_FULL;
+
+            // Keep drawing into a dropped frame's buffer, it's still ours
+            if (result != SCREEN_UPDATE_DROPPED)
+            {
+                previousUpdate = currentUpdate;
+                currentUpdate = (currentUpdate == &update1) ? &update2 : &update1;
+                gPrimaryFrameBuffer = (UBYTE*)currentUpdate->buffer;
+            }
         }
 
         // See if we need to skip a frame to keep up
@@ -24,6 +24,23 @@ int UPeriod = 0;
 static int display_counter = 0;
 static int last_display_counter = 0;
 
+// Lines are rendered a strip at a time into an internal RAM buffer and then
+// copied to the frame buffer (in PSRAM) in bulk, instead of writing it byte by byte
+#define STAGE_LINES 16
+
+static uchar *stage_buffer = NULL;
+static bool stage_enabled = true;
+
+// Lines from the top of the frame that went through the staging buffer
+static int staged_lines = 0;
+
+#ifdef RENDER_DEBUG
+static struct {
+	uint32 lines;
+	uint32 time;
+} render_stats;
+#endif
+
 
 //! Computes the new screen height and eventually change the screen mode
 void
@@ -94,6 +111,11 @@ gfx_init()
 	VRAM2 = VRAM2 ?: (uchar *)rg_alloc(VRAMSIZE, MEM_FAST);
     memset(&SPR_CACHE, 0, sizeof(SPR_CACHE));
 
+	// Rendering straight to PSRAM can be selected to compare both methods
+	stage_enabled = odroid_settings_app_int32_get("StagedRender", 1);
+	if (stage_enabled)
+		stage_buffer = stage_buffer ?: (uchar *)rg_alloc(XBUF_WIDTH * STAGE_LINES, MEM_FAST);
+
 	osd_gfx_init();
 
 	// Build palette
@@ -167,6 +189,73 @@ gfx_load_context(char slot_number)
 
 
 //! Render lines
+static inline void
+draw_lines(int min_line, int max_line)
+{
+	if (SpriteON && SPONSwitch)
+	{
+		RefreshSpriteExact(min_line, max_line, 0); // max_line + 1
+		RefreshLine(min_line, max_line); // max_line + 1
+		RefreshSpriteExact(min_line, max_line, 1);  // max_line + 1
+	}
+	else
+		RefreshLine(min_line, max_line); // max_line + 1
+}
+
+
+/*
+	draw lines through the staging buffer, one strip at a time. Sprites and
+	tiles only write within the lines they're asked to draw, plus 32 columns
+	of margin on each side, so a strip only needs full XBUF_WIDTH lines.
+*/
+static inline void
+draw_lines_staged(int min_line, int max_line)
+{
+	uchar *frame = osd_gfx_buffer;
+
+	for (int y = min_line; y < max_line; y += STAGE_LINES)
+	{
+		int lines = MIN(STAGE_LINES, max_line - y);
+
+		// Tiles and sprites skip transparent pixels, they show the background color
+		memset(stage_buffer, Palette[0], XBUF_WIDTH * lines);
+
+		// Line y of the frame maps to the first line of the strip
+		osd_gfx_buffer = stage_buffer + 32 - y * XBUF_WIDTH;
+		draw_lines(y, y + lines);
+		osd_gfx_buffer = frame;
+
+		memcpy(frame - 32 + y * XBUF_WIDTH, stage_buffer, XBUF_WIDTH * lines);
+	}
+
+	if (min_line <= staged_lines)
+		staged_lines = MAX(staged_lines, max_line);
+}
+
+
+/*
+	Called once the frame is complete, before it's handed to the display.
+	Staged lines were written in full, so only the lines that weren't rendered
+	are cleared to the background color. Returns false when rendering straight
+	to the frame, it must then be cleared after its transfer instead.
+*/
+bool
+gfx_finish_frame(uchar *frame, int width, int height)
+{
+	int lines = staged_lines;
+
+	staged_lines = 0;
+
+	if (!stage_buffer || !stage_enabled)
+		return false;
+
+	for (int y = lines; y < height; y++)
+		memset(frame + y * XBUF_WIDTH, Palette[0], width);
+
+	return true;
+}
+
+
 /*
 	render lines into the buffer from min_line to max_line (inclusive)
 */
@@ -175,22 +264,34 @@ render_lines(int min_line, int max_line)
 {
 	if (osd_skipFrames == 0 && UCount == 0) // Check for frameskip
 	{
+#ifdef RENDER_DEBUG
+		uint start = get_elapsed_time();
+#endif
+
 		gfx_save_context(1);
 		gfx_load_context(0);
 
 		// Temp hack
 		if (max_line == 239) max_line = 240;
 
-		if (SpriteON && SPONSwitch)
-		{
-			RefreshSpriteExact(min_line, max_line, 0); // max_line + 1
-			RefreshLine(min_line, max_line); // max_line + 1
-			RefreshSpriteExact(min_line, max_line, 1);  // max_line + 1
-		}
+		if (stage_buffer && stage_enabled)
+			draw_lines_staged(min_line, max_line);
 		else
-			RefreshLine(min_line, max_line); // max_line + 1
+			draw_lines(min_line, max_line);
 
 		gfx_load_context(1);
+
+#ifdef RENDER_DEBUG
+		render_stats.time += get_elapsed_time_since(start);
+		render_stats.lines += MAX(max_line - min_line, 0);
+
+		if (render_stats.lines >= 240 * 300) {
+			printf("%s: %dus per 240 lines (%s)\n", __func__,
+				render_stats.time / (render_stats.lines / 240),
+				stage_enabled ? "staged" : "direct");
+			memset(&render_stats, 0, sizeof(render_stats));
+		}
+#endif
 	}
 
 	gfx_need_redraw = 0;
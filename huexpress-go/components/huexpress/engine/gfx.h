@@ -13,6 +13,10 @@
 #define XBUF_WIDTH 	(360 + 32 + 32)
 #define	XBUF_HEIGHT	(240 + 64 + 64)
 
+// Sprites are clipped vertically to the rendered lines, so the sprite mask
+// only needs the horizontal margins
+#define	SPM_HEIGHT	(240 + 16)
+
 typedef struct {
 	int16 scroll_x;
 	int16 scroll_y;
@@ -26,6 +30,7 @@ void gfx_change_video_mode();
 void gfx_save_context(char slot_number);
 void gfx_load_context(char slot_number);
 char gfx_loop();
+bool gfx_finish_frame(uchar *frame, int width, int height);
 
 extern int UCount;
 extern int UPeriod;
@@ -24,6 +24,8 @@
 #include "pce.h"
 #include "romdb.h"
 #include "rom/crc.h"
+#include <sys/stat.h>
+#include <unistd.h>
 
 struct host_machine host;
 
@@ -77,6 +79,71 @@ const svar_t SaveStateVars[] =
 };
 
 
+// The ROM cache holds what LoadCard learns about a HuCard, so that the next
+// boot doesn't have to compute the CRC, look it up or decrypt the ROM again.
+// It's keyed by the size and modification time of the ROM file.
+#define ROM_CACHE_MAGIC   0x43454350 // "PCEC"
+#define ROM_CACHE_VERSION 1
+
+typedef struct {
+	uint32 magic;
+	uint32 version;
+	uint32 size;
+	uint32 mtime;
+	uint32 crc;
+	uint32 flags;
+	uint32 decrypted; // The decrypted image follows the header
+} rom_cache_t;
+
+
+static bool
+LoadCardCache(const char *path, rom_cache_t *cache, struct stat *st)
+{
+	bool success = false;
+	FILE *fp = fopen(path, "rb");
+
+	if (fp) {
+		success = fread(cache, sizeof(rom_cache_t), 1, fp) == 1
+			&& cache->magic == ROM_CACHE_MAGIC && cache->version == ROM_CACHE_VERSION
+			&& cache->size == st->st_size && cache->mtime == st->st_mtime;
+
+		if (success && cache->decrypted)
+			success = fread(ROM, cache->size, 1, fp) == 1;
+
+		fclose(fp);
+	}
+
+	return success;
+}
+
+
+static void
+SaveCardCache(const char *path, rom_cache_t *cache)
+{
+	char dir[256];
+
+	strncpy(dir, path, sizeof(dir) - 1);
+	dir[sizeof(dir) - 1] = 0;
+	if (strrchr(dir, '/'))
+		*strrchr(dir, '/') = 0;
+	odroid_sdcard_mkdir(dir);
+
+	FILE *fp = fopen(path, "wb");
+
+	if (fp) {
+		bool success = fwrite(cache, sizeof(rom_cache_t), 1, fp) == 1;
+
+		if (success && cache->decrypted)
+			success = fwrite(ROM, cache->size, 1, fp) == 1;
+
+		fclose(fp);
+
+		if (!success)
+			unlink(path);
+	}
+}
+
+
 /**
  * Load card into memory and set its memory map
  */
@@ -84,12 +151,12 @@ int
 LoadCard(const char *name)
 {
 	int fsize, offset;
+	uint startTime = get_elapsed_time();
+	struct stat st;
 
 	MESSAGE_INFO("Opening %s...\n", name);
 
-	FILE *fp = fopen(name, "rb");
-
-	if (fp == NULL)
+	if (stat(name, &st) != 0)
 	{
 		MESSAGE_ERROR("Failed to open %s!\n", name);
 		return -1;
@@ -100,8 +167,7 @@ LoadCard(const char *name)
 	}
 
 	// find file size
-	fseek(fp, 0, SEEK_END);
-	fsize = ftell(fp);
+	fsize = st.st_size;
 	offset = fsize & 0x1fff;
 
 	// read ROM
@@ -115,53 +181,77 @@ LoadCard(const char *name)
 		return -1;
 	}
 
-	fseek(fp, 0, SEEK_SET);
-	fread(ROM, 1, fsize, fp);
+	char *cachePath = odroid_system_get_path(ODROID_PATH_ROM_CACHE, name);
+	rom_cache_t cache;
+	bool cached = LoadCardCache(cachePath, &cache, &st);
 
-	fclose(fp);
+	// A decrypted ROM was read from the cache already
+	if (!(cached && cache.decrypted))
+	{
+		if (odroid_sdcard_copy_file_to_memory(name, ROM, fsize) != fsize)
+		{
+			MESSAGE_ERROR("Failed to read %s!\n", name);
+			free(cachePath);
+			return -1;
+		}
+	}
 
-	uint32 CRC = crc32_le(0, ROM, fsize);
-	uint16 IDX = 0;
-	uint32 ROM_MASK = 1;
+	if (!cached)
+	{
+		cache = (rom_cache_t) {
+			.magic = ROM_CACHE_MAGIC,
+			.version = ROM_CACHE_VERSION,
+			.size = fsize,
+			.mtime = st.st_mtime,
+			.crc = crc32_le(0, ROM, fsize),
+		};
 
-	while (ROM_MASK < ROM_SIZE) ROM_MASK <<= 1;
-	ROM_MASK--;
+		cache.flags = romFlags[romdb_find(cache.crc)].Flags;
 
-	MESSAGE_INFO("ROM LOADED: OFFSET=%d, BANKS=%d, MASK=%03X, CRC=%08X\n", offset, ROM_SIZE, ROM_MASK, CRC);
+		// US Encrypted
+		if ((cache.flags & US_ENCODED) || ROM_PTR[0x1FFF] < 0xE0)
+		{
+			MESSAGE_INFO("This rom is probably US encrypted, decrypting...\n");
+
+			uchar inverted_nibble[16] = {
+				0, 8, 4, 12, 2, 10, 6, 14,
+				1, 9, 5, 13, 3, 11, 7, 15
+			};
 
-	for (int index = 0; index < KNOWN_ROM_COUNT; index++) {
-		if (CRC == romFlags[index].CRC) {
-			IDX = index;
-			break;
+			for (uint32 x = 0; x < ROM_SIZE * 0x2000; x++) {
+				uchar temp = ROM_PTR[x] & 15;
+
+				ROM_PTR[x] &= ~0x0F;
+				ROM_PTR[x] |= inverted_nibble[ROM_PTR[x] >> 4];
+
+				ROM_PTR[x] &= ~0xF0;
+				ROM_PTR[x] |= inverted_nibble[temp] << 4;
+			}
+
+			cache.decrypted = 1;
 		}
+
+		SaveCardCache(cachePath, &cache);
 	}
 
-	MESSAGE_INFO("Game Name: %s\n", romFlags[IDX].Name);
-	MESSAGE_INFO("Game Region: %s\n", (romFlags[IDX].Flags & JAP) ? "Japan" : "USA");
+	free(cachePath);
 
-	// US Encrypted
-	if ((romFlags[IDX].Flags & US_ENCODED) || ROM_PTR[0x1FFF] < 0xE0)
-	{
-		MESSAGE_INFO("This rom is probably US encrypted, decrypting...\n");
-
-		uchar inverted_nibble[16] = {
-			0, 8, 4, 12, 2, 10, 6, 14,
-			1, 9, 5, 13, 3, 11, 7, 15
-		};
+	uint32 CRC = cache.crc;
+	uint16 IDX = romdb_find(CRC);
+	uint32 ROM_MASK = 1;
 
-		for (uint32 x = 0; x < ROM_SIZE * 0x2000; x++) {
-			uchar temp = ROM_PTR[x] & 15;
+	while (ROM_MASK < ROM_SIZE) ROM_MASK <<= 1;
+	ROM_MASK--;
 
-			ROM_PTR[x] &= ~0x0F;
-			ROM_PTR[x] |= inverted_nibble[ROM_PTR[x] >> 4];
+	MESSAGE_INFO("ROM LOADED: OFFSET=%d, BANKS=%d, MASK=%03X, CRC=%08X\n", offset, ROM_SIZE, ROM_MASK, CRC);
+	MESSAGE_INFO("ROM LOADED: %dms (%s)\n", get_elapsed_time_since(startTime) / 1000,
+		cached ? "cached" : "not cached");
 
-			ROM_PTR[x] &= ~0xF0;
-			ROM_PTR[x] |= inverted_nibble[temp] << 4;
-		}
-	}
+	MESSAGE_INFO("Game Name: %s\n", romFlags[IDX].Name);
+	MESSAGE_INFO("Game Region: %s\n", (cache.flags & JAP) ? "Japan" : "USA");
 
 	// For example with Devil Crush 512Ko
-	if (romFlags[IDX].Flags & TWO_PART_ROM)
+	if (cache.flags & TWO_PART_ROM)
 		ROM_SIZE = 0x30;
 
     // Game ROM
@@ -8,17 +8,36 @@
 #define USA          0x4000
 #define JAP          0x8000
 
+// Must be kept sorted by CRC, it is binary searched. The first entry is used for unknown ROMs.
 const struct {
 	const uint32 CRC;
 	const char   *Name;
 	const uint32 Flags;
 } romFlags[] = {
 	{0x00000000, "Unknown", JAP},
-	{0xF0ED3094, "Blazing Lazers", USA | TWO_PART_ROM},
-	{0xB4A1B0F6, "Blazing Lazers", USA | TWO_PART_ROM},
 	{0x55E9630D, "Legend of Hero Tonma", USA | US_ENCODED},
+	{0xB4A1B0F6, "Blazing Lazers", USA | TWO_PART_ROM},
+	{0xF0ED3094, "Blazing Lazers", USA | TWO_PART_ROM},
 };
 
 #define KNOWN_ROM_COUNT (sizeof(romFlags) / sizeof(romFlags[0]))
 
+static inline int
+romdb_find(uint32 CRC)
+{
+	int lo = 1, hi = KNOWN_ROM_COUNT - 1;
+
+	while (lo <= hi) {
+		int mid = (lo + hi) / 2;
+		if (romFlags[mid].CRC == CRC)
+			return mid;
+		if (romFlags[mid].CRC < CRC)
+			lo = mid + 1;
+		else
+			hi = mid - 1;
+	}
+
+	return 0;
+}
+
 #endif /* _ROMFLAGS_H */
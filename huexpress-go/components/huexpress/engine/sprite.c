@@ -47,8 +47,98 @@ uchar sprite_usespbg = 0;
 int ScrollYDiff;
 
 // Actual memory area where the gfx functions are drawing sprites and tiles
-uchar *SPM_raw;//[XBUF_WIDTH * XBUF_HEIGHT];
-uchar *SPM;// = SPM_raw + XBUF_WIDTH * 64 + 32;
+uchar *SPM_raw;//[XBUF_WIDTH * SPM_HEIGHT];
+uchar *SPM;// = SPM_raw + 32;
+
+// Columns of each SPM line written since the last clear, [left, right)
+static int16 SPM_dirty_left[SPM_HEIGHT];
+static int16 SPM_dirty_right[SPM_HEIGHT];
+static int16 SPM_dirty_top = SPM_HEIGHT, SPM_dirty_bottom = 0;
+
+#ifdef RENDER_DEBUG
+static struct {
+	uint32 frames;
+	uint32 cleared;
+	uint32 full;
+} SPM_stats;
+#endif
+
+
+/*****************************************************************************
+
+		Function: MarkSpriteMask
+
+		Description: remember which part of the sprite mask a sprite wrote to
+		Parameters: int y, int h (lines), int left, int right (columns)
+		Return: nothing
+
+*****************************************************************************/
+static inline void
+MarkSpriteMask(int y, int h, int left, int right)
+{
+	if (left < -32) left = -32;
+	if (right > XBUF_WIDTH - 32) right = XBUF_WIDTH - 32;
+	if (y < 0) {
+		h += y;
+		y = 0;
+	}
+	if (y + h > SPM_HEIGHT) h = SPM_HEIGHT - y;
+
+	if (h <= 0 || left >= right)
+		return;
+
+	if (y < SPM_dirty_top) SPM_dirty_top = y;
+	if (y + h > SPM_dirty_bottom) SPM_dirty_bottom = y + h;
+
+	for (int i = y; i < y + h; i++) {
+		if (SPM_dirty_left[i] >= SPM_dirty_right[i]) {
+			SPM_dirty_left[i] = left;
+			SPM_dirty_right[i] = right;
+			continue;
+		}
+		if (left < SPM_dirty_left[i]) SPM_dirty_left[i] = left;
+		if (right > SPM_dirty_right[i]) SPM_dirty_right[i] = right;
+	}
+}
+
+
+/*****************************************************************************
+
+		Function: ClearSpriteMask
+
+		Description: clear the parts of the sprite mask written since the last
+			call, instead of the whole screen
+		Parameters: none
+		Return: nothing
+
+*****************************************************************************/
+void
+ClearSpriteMask(void)
+{
+	for (int i = SPM_dirty_top; i < SPM_dirty_bottom; i++) {
+		int width = SPM_dirty_right[i] - SPM_dirty_left[i];
+		if (width > 0) {
+			memset(SPM + i * XBUF_WIDTH + SPM_dirty_left[i], 0, width);
+#ifdef RENDER_DEBUG
+			SPM_stats.cleared += width;
+#endif
+		}
+		SPM_dirty_left[i] = SPM_dirty_right[i] = 0;
+	}
+
+	SPM_dirty_top = SPM_HEIGHT;
+	SPM_dirty_bottom = 0;
+
+#ifdef RENDER_DEBUG
+	SPM_stats.full += 240 * io.screen_w;
+
+	if (++SPM_stats.frames == 300) {
+		printf("%s: %d bytes cleared per frame instead of %d\n", __func__,
+			SPM_stats.cleared / SPM_stats.frames, SPM_stats.full / SPM_stats.frames);
+		memset(&SPM_stats, 0, sizeof(SPM_stats));
+	}
+#endif
+}
 
 /*
 	Hit Chesk Sprite#0 and others
@@ -832,6 +922,7 @@ RefreshSpriteExact(int Y1, int Y2, uchar bg)
                 h = Y2 - y - y_sum;
             if (spbg == 0) {
                 sprite_usespbg = 1;
+                MarkSpriteMask(y + y_sum + (t > 0 ? t : 0), h, x, x + (cgx + 1) * 16);
                 if (atr & H_FLIP) {
                     for (j = 0; j <= cgx; j++) {
                         PutSpriteHflipMakeMask(osd_gfx_buffer + pos
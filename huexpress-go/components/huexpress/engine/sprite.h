@@ -40,6 +40,8 @@ extern sprite_cache_t SPR_CACHE;
 
 extern uchar *SPM;
 
+extern void ClearSpriteMask(void);
+
 extern uchar *VRAM2, *VRAMS;
 /* these contain linear representations that we can draw */
 
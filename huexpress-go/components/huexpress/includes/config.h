@@ -29,6 +29,9 @@
 /* for hugo developers working on netplay emulation */
 #undef NETPLAY_DEBUG
 
+/* for hugo developers working on the renderer, prints stats every 300 frames */
+#undef RENDER_DEBUG
+
 /* Define to empty if `const' does not conform to ANSI C. */
 // #undef const
 
@@ -30,6 +30,8 @@
 extern uchar *osd_gfx_buffer;
 extern uint osd_blitFrames;
 extern uint osd_skipFrames;
+extern uint osd_minSkipFrames;
+extern uint osd_maxSkipFrames;
 
 extern void osd_gfx_init();
 extern void osd_gfx_shutdown();
@@ -12,7 +12,8 @@
 #include <string.h>
 #include <osd.h>
 
-static uint16_t mypalette[256];
+static odroid_palette_t mypalette;
+static uint16_t palettes[2][256];
 static uint8_t *framebuffers[2];
 static odroid_video_frame frames[2];
 static odroid_video_frame *curFrame;
@@ -22,6 +23,9 @@ static bool gfx_init_done = false;
 uchar* osd_gfx_buffer = NULL;
 uint osd_skipFrames = 0;
 uint osd_blitFrames = 0;
+// Frames always skipped after a drawn one, and the most skipped in a row when late
+uint osd_minSkipFrames = 0;
+uint osd_maxSkipFrames = 2;
 
 extern uchar *SPM_raw, *SPM;
 
@@ -36,10 +40,7 @@ static inline void set_current_fb(int i)
     osd_gfx_buffer = frames[current_fb].buffer;
     curFrame = &frames[current_fb];
 
-    for (int i = 0; i < 240; i++) {
-        // memset(osd_gfx_buffer + i * XBUF_WIDTH, Palette[0], io.screen_w);
-        memset(SPM + i * XBUF_WIDTH, 0, io.screen_w);
-    }
+    ClearSpriteMask();
 }
 
 
@@ -68,8 +69,12 @@ void osd_gfx_init(void)
 {
     framebuffers[0] = rg_alloc(XBUF_WIDTH * XBUF_HEIGHT, MEM_SLOW);
     framebuffers[1] = rg_alloc(XBUF_WIDTH * XBUF_HEIGHT, MEM_SLOW);
-    SPM_raw         = rg_alloc(XBUF_WIDTH * XBUF_HEIGHT, MEM_SLOW);
-    SPM = SPM_raw + XBUF_WIDTH * 64 + 32;
+    // The sprite mask is read for every sprite pixel, keep it in internal RAM if it fits
+    SPM_raw         = rg_alloc(XBUF_WIDTH * SPM_HEIGHT, MEM_FAST);
+    SPM = SPM_raw + 32;
+
+    osd_minSkipFrames = odroid_settings_app_int32_get("MinSkip", 0);
+    osd_maxSkipFrames = odroid_settings_app_int32_get("MaxSkip", 2);
 
     // UPeriod = 1;
 
@@ -92,8 +97,9 @@ void osd_gfx_set_mode(short width, short height)
 	frames[0].pixel_size = 1;
 	frames[0].pixel_mask = 0xFF;
     frames[0].pixel_clear = 0;
-	frames[0].palette = mypalette;
 	frames[1] = frames[0];
+	frames[0].palette = palettes[0];
+	frames[1].palette = palettes[1];
 
 	frames[0].buffer = framebuffers[0] + 32 + 64 * XBUF_WIDTH + (crop_w / 2) + (crop_h / 2) * XBUF_WIDTH;
 	frames[1].buffer = framebuffers[1] + 32 + 64 * XBUF_WIDTH + (crop_w / 2) + (crop_h / 2) * XBUF_WIDTH;
@@ -110,26 +116,23 @@ void osd_gfx_blit(void)
     if (!gfx_init_done) return;
 
     bool drawFrame = !osd_skipFrames;
-    bool fullFrame = true;
 
     if (drawFrame)
     {
         // xQueueSend(videoTaskQueue, &curFrame, portMAX_DELAY);
-        curFrame->pixel_clear = Palette[0];
+        // Direct rendering only draws the opaque pixels, the display clears
+        // the frame to the background color once it's done with it
+        curFrame->pixel_clear = gfx_finish_frame(curFrame->buffer, curFrame->width,
+            curFrame->height) ? -1 : Palette[0];
+        odroid_palette_latch(&mypalette, curFrame, 256);
         odroid_display_queue_update(curFrame, NULL);
         set_current_fb(!current_fb);
         osd_blitFrames++;
     }
-
-    // See if we need to skip a frame to keep up
-    if (osd_skipFrames == 0)
-    {
-        osd_skipFrames++;
-
-        if (speedupEnabled) osd_skipFrames += speedupEnabled * 2.5;
-    }
-    else if (osd_skipFrames > 0)
+    else
     {
+        // The number of frames to skip is decided in osd_wait_next_vsync once
+        // the cost of the drawn frame is known
         osd_skipFrames--;
     }
 }
@@ -151,7 +154,6 @@ void osd_gfx_set_color(uchar index, uchar r, uchar g, uchar b)
     else
     {
         col = COLOR_RGB(r >> 2, g >> 2, b >> 2);
-        col = (col << 8) | (col >> 8);
     }
-    mypalette[index] = col;
+    odroid_palette_set(&mypalette, index, col);
 }
@@ -38,12 +38,32 @@ void osd_wait_next_vsync(void)
 		select(1, NULL, NULL, NULL, &tp);
 		usleep(sleep);
 	}
-	else if (sleep < -8333.0)
+
+	uint busyTime = curtime - prevtime;
+
+	// See if we need to skip frames to keep up, based on what the drawn frame cost
+	if (osd_blitFrames)
 	{
-		osd_skipFrames++;
+		osd_skipFrames = osd_minSkipFrames;
+
+		// More than half a frame late, skip as many frames as we're behind
+		if (sleep < -deltatime / 2)
+			osd_skipFrames += 1 + (uint)(-sleep / deltatime);
+		else if (busyTime > deltatime)
+			osd_skipFrames++;
+
+		if (osd_skipFrames > osd_maxSkipFrames)
+			osd_skipFrames = MAX(osd_maxSkipFrames, osd_minSkipFrames);
+
+		if (speedupEnabled)
+			osd_skipFrames += speedupEnabled * 2.5;
 	}
 
-    odroid_system_tick(!osd_blitFrames, true, (uint)(curtime - prevtime));
+	// Movie checkpoints must be drawn, the next latch is at the end of the frame
+	if (odroid_movie_checkpoint_due(true))
+		osd_skipFrames = 0;
+
+    odroid_system_tick(!osd_blitFrames, true, busyTime);
 	osd_blitFrames = 0;
 
 	gettimeofday(&tp, NULL);
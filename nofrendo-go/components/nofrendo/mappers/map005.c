@@ -418,7 +418,7 @@ static uint8 map5_vram_read(uint32 address, uint8 value)
          else if (split_region)
          {
             // CHR tile fetches for split region
-            return nes->mmc->chr[vert_split.bank * 0x1000 + (((address & ~0x07) | (vscroll & 0x07)) & 0xFFF)];
+            return mmc_getchrbyte(vert_split.bank * 0x1000 + (((address & ~0x07) | (vscroll & 0x07)) & 0xFFF));
          }
       }
 
@@ -452,7 +452,7 @@ static uint8 map5_vram_read(uint32 address, uint8 value)
             else
             {
                //PPU tile data fetch (high byte & low byte)
-               return nes->mmc->chr[_exAttrSelectedChrBank * 0x1000 + (address & 0xFFF)];
+               return mmc_getchrbyte(_exAttrSelectedChrBank * 0x1000 + (address & 0xFFF));
             }
          }
       }
@@ -76,14 +76,12 @@ static void map19_write(uint32 address, uint8 value)
    case 0x18:
    case 0x19:
    case 0x1A:
-   case 0x1B: {
-      rominfo_t *cart = mmc_getinfo();
+   case 0x1B:
       if (value < 0xE0)
-         ppu_setpage(1, (reg & 3) + 8, &cart->vrom[(value % (cart->vrom_banks * 8)) << 10] - (0x2000 + ((reg & 3) << 10)));
+         ppu_setpage(1, (reg & 3) + 8, mmc_getvrom((reg & 3) + 8, value) - (0x2000 + ((reg & 3) << 10)));
       else
          ppu_setpage(1, (reg & 3) + 8, ppu_getnametable(value & 1) - (0x2000 + ((reg & 3) << 10)));
       ppu_mirrorhipages();
-      }
       break;
 
    case 0x1C:
@@ -46,20 +46,36 @@ static void map24_init(void)
    irq.latch = irq.wait_state = 0;
 }
 
-static void map24_hblank(int vblank)
+/* The counter ticks once per scanline. While it's enabled it runs as the
+** NES timer instead, and is only brought up to date when we need it.
+*/
+static int map24_getcounter(void)
 {
-   UNUSED(vblank);
+   float cycles_per_line = nes_getptr()->cycles_per_line;
+
+   if (!irq.enabled)
+      return irq.counter;
+
+   return MIN(255, 256 - (int)((nes_gettimer() + cycles_per_line - 1) / cycles_per_line));
+}
 
+static void map24_timer(void);
+
+static void map24_schedule(void)
+{
    if (irq.enabled)
-   {
-      if (256 == ++irq.counter)
-      {
-         irq.counter = irq.latch;
-         nes6502_irq();
-         //irq.enabled = false;
-         irq.enabled = irq.wait_state;
-      }
-   }
+      nes_settimer(map24_timer, (256 - irq.counter) * nes_getptr()->cycles_per_line);
+   else
+      nes_settimer(NULL, 0);
+}
+
+static void map24_timer(void)
+{
+   irq.counter = irq.latch;
+   nes6502_irq();
+   //irq.enabled = false;
+   irq.enabled = irq.wait_state;
+   map24_schedule();
 }
 
 static void map24_write(uint32 address, uint8 value)
@@ -140,14 +156,18 @@ static void map24_write(uint32 address, uint8 value)
       break;
 
    case 0xF001:
+      irq.counter = map24_getcounter();
       irq.enabled = (value >> 1) & 0x01;
       irq.wait_state = value & 0x01;
       if (irq.enabled)
          irq.counter = irq.latch;
+      map24_schedule();
       break;
 
    case 0xF002:
+      irq.counter = map24_getcounter();
       irq.enabled = irq.wait_state;
+      map24_schedule();
       break;
 
    default:
@@ -158,7 +178,7 @@ static void map24_write(uint32 address, uint8 value)
 
 static void map24_getstate(void *state)
 {
-   ((mapper24Data*)state)->irqCounter = irq.counter;
+   ((mapper24Data*)state)->irqCounter = map24_getcounter();
    ((mapper24Data*)state)->irqCounterEnabled = irq.enabled;
 }
 
@@ -166,6 +186,7 @@ static void map24_setstate(void *state)
 {
    irq.counter = ((mapper24Data*)state)->irqCounter;
    irq.enabled = ((mapper24Data*)state)->irqCounterEnabled;
+   map24_schedule();
 }
 
 static mem_write_handler_t map24_memwrite[] =
@@ -180,7 +201,7 @@ mapintf_t map24_intf =
    "Konami VRC6", /* mapper name */
    map24_init, /* init routine */
    NULL, /* vblank callback */
-   map24_hblank, /* hblank callback */
+   NULL, /* hblank callback */
    map24_getstate, /* get state (snss) */
    map24_setstate, /* set state (snss) */
    NULL, /* memory read structure */
@@ -34,13 +34,34 @@ typedef struct
    unsigned char irqCounterEnabled;
 } mapper40Data;
 
-#define  MAP40_IRQ_PERIOD  (4096 / 113.666666)
+#define  MAP40_IRQ_PERIOD  4096
 
 static struct
 {
-   int enabled, counter;
+   int enabled, counter; /* counter is in CPU cycles */
 } irq;
 
+static void map40_timer(void)
+{
+   nes6502_irq();
+   irq.enabled = false;
+   irq.counter = 0;
+}
+
+/* The counter only runs while enabled, when it's handed to the NES timer */
+static void map40_setenabled(int enabled)
+{
+   if (irq.enabled)
+      irq.counter = nes_gettimer();
+
+   irq.enabled = enabled;
+
+   if (irq.enabled && irq.counter)
+      nes_settimer(map40_timer, irq.counter);
+   else
+      nes_settimer(NULL, 0);
+}
+
 /* mapper 40: SMB 2j (hack) */
 static void map40_init(void)
 {
@@ -50,22 +71,7 @@ static void map40_init(void)
    mmc_bankrom(8, 0xE000, 7);
 
    irq.enabled = false;
-   irq.counter = (int) MAP40_IRQ_PERIOD;
-}
-
-static void map40_hblank(int vblank)
-{
-   UNUSED(vblank);
-
-   if (irq.enabled && irq.counter)
-   {
-      irq.counter--;
-      if (0 == irq.counter)
-      {
-         nes6502_irq();
-         irq.enabled = false;
-      }
-   }
+   irq.counter = MAP40_IRQ_PERIOD;
 }
 
 static void map40_write(uint32 address, uint8 value)
@@ -75,12 +81,13 @@ static void map40_write(uint32 address, uint8 value)
    switch (range)
    {
    case 0: /* 0x8000-0x9FFF */
-      irq.enabled = false;
-      irq.counter = (int) MAP40_IRQ_PERIOD;
+      map40_setenabled(false);
+      irq.counter = MAP40_IRQ_PERIOD;
       break;
 
    case 1: /* 0xA000-0xBFFF */
-      irq.enabled = true;
+      if (!irq.enabled)
+         map40_setenabled(true);
       break;
 
    case 3: /* 0xE000-0xFFFF */
@@ -92,16 +99,21 @@ static void map40_write(uint32 address, uint8 value)
    }
 }
 
+/* The counter is saved in scanlines, as it used to be counted */
 static void map40_getstate(void *state)
 {
-   ((mapper40Data*)state)->irqCounter = irq.counter;
+   float cycles_per_line = nes_getptr()->cycles_per_line;
+   int counter = irq.enabled ? nes_gettimer() : irq.counter;
+
+   ((mapper40Data*)state)->irqCounter = (counter + cycles_per_line - 1) / cycles_per_line;
    ((mapper40Data*)state)->irqCounterEnabled = irq.enabled;
 }
 
 static void map40_setstate(void *state)
 {
-   irq.counter = ((mapper40Data*)state)->irqCounter;
-   irq.enabled = ((mapper40Data*)state)->irqCounterEnabled;
+   irq.enabled = false;
+   irq.counter = ((mapper40Data*)state)->irqCounter * nes_getptr()->cycles_per_line;
+   map40_setenabled(((mapper40Data*)state)->irqCounterEnabled);
 }
 
 static mem_write_handler_t map40_memwrite[] =
@@ -116,7 +128,7 @@ mapintf_t map40_intf =
    "SMB 2j (pirate)", /* mapper name */
    map40_init, /* init routine */
    NULL, /* vblank callback */
-   map40_hblank, /* hblank callback */
+   NULL, /* hblank callback */
    map40_getstate, /* get state (snss) */
    map40_setstate, /* set state (snss) */
    NULL, /* memory read structure */
@@ -33,17 +33,22 @@
 static struct
 {
   bool enabled;
-  uint32 counter;
 } irq;
 
+typedef struct
+{
+  unsigned char irqCounterEnabled;
+  unsigned short irqCyclesLeft;
+} mapper42Data;
+
 /********************************/
 /* Mapper #42 IRQ reset routine */
 /********************************/
 static void map42_irq_reset (void)
 {
-  /* Turn off IRQs */
+  /* Turn off IRQs, this also clears the counter */
   irq.enabled = false;
-  irq.counter = 0x0000;
+  nes_settimer (NULL, 0);
 
   /* Done */
   return;
@@ -70,29 +75,13 @@ static void map42_init (void)
 /****************************************/
 /* Mapper #42 callback for IRQ handling */
 /****************************************/
-static void map42_hblank (int vblank)
+static void map42_timer (void)
 {
-   /* Counter is M2 based so it doesn't matter whether */
-   /* the PPU is in its VBlank period or not           */
-   UNUSED(vblank);
-
-   /* Increment the counter if it is enabled and check for strike */
-   if (irq.enabled)
-   {
-     /* Is there a constant for cycles per scanline? */
-     /* If so, someone ought to substitute it here   */
-     irq.counter = irq.counter + 114;
-
-     /* IRQ is triggered after 24576 M2 cycles */
-     if (irq.counter >= 0x6000)
-     {
-       /* Trigger the IRQ */
-       nes6502_irq ();
-
-       /* Reset the counter */
-       map42_irq_reset ();
-     }
-   }
+  /* Trigger the IRQ */
+  nes6502_irq ();
+
+  /* Reset the counter */
+  map42_irq_reset ();
 }
 
 /******************************************/
@@ -112,8 +101,13 @@ static void map42_write (uint32 address, uint8 value)
                break;
 
     /* Register 2: IRQ */
-    case 0x02: if (value & 0x02) irq.enabled = true;
-               else              map42_irq_reset ();
+    /* IRQ is triggered after 24576 M2 cycles */
+    case 0x02: if (!(value & 0x02))    map42_irq_reset ();
+               else if (!irq.enabled)
+               {
+                 irq.enabled = true;
+                 nes_settimer (map42_timer, 0x6000);
+               }
                break;
 
     /* Register 3: unused */
@@ -124,6 +118,22 @@ static void map42_write (uint32 address, uint8 value)
   return;
 }
 
+/* The counter runs as the NES timer, only the cycles left are saved */
+static void map42_getstate (void *state)
+{
+  ((mapper42Data*)state)->irqCounterEnabled = irq.enabled;
+  ((mapper42Data*)state)->irqCyclesLeft = irq.enabled ? nes_gettimer () : 0;
+}
+
+static void map42_setstate (void *state)
+{
+  irq.enabled = ((mapper42Data*)state)->irqCounterEnabled;
+  if (irq.enabled)
+    nes_settimer (map42_timer, ((mapper42Data*)state)->irqCyclesLeft);
+  else
+    nes_settimer (NULL, 0);
+}
+
 static mem_write_handler_t map42_memwrite [] =
 {
    { 0xE000, 0xFFFF, map42_write },
@@ -136,9 +146,9 @@ mapintf_t map42_intf =
    "Baby Mario (bootleg)",           /* Mapper name */
    map42_init,                       /* Initialization routine */
    NULL,                             /* VBlank callback */
-   map42_hblank,                     /* HBlank callback */
-   NULL,                             /* Get state (SNSS) */
-   NULL,                             /* Set state (SNSS) */
+   NULL,                             /* HBlank callback */
+   map42_getstate,                   /* Get state (SNSS) */
+   map42_setstate,                   /* Set state (SNSS) */
    NULL,                             /* Memory read structure */
    map42_memwrite,                   /* Memory write structure */
    NULL                              /* External sound device */
@@ -33,17 +33,22 @@
 static struct
 {
   bool enabled;
-  uint32 counter;
 } irq;
 
+typedef struct
+{
+  unsigned char irqCounterEnabled;
+  unsigned short irqCyclesLeft;
+} mapper50Data;
+
 /********************************/
 /* Mapper #50 IRQ reset routine */
 /********************************/
 static void map50_irq_reset (void)
 {
-  /* Turn off IRQs */
+  /* Turn off IRQs, this also clears the counter */
   irq.enabled = false;
-  irq.counter = 0x0000;
+  nes_settimer (NULL, 0);
 
   /* Done */
   return;
@@ -70,29 +75,13 @@ static void map50_init (void)
 /****************************************/
 /* Mapper #50 callback for IRQ handling */
 /****************************************/
-static void map50_hblank (int vblank)
+static void map50_timer (void)
 {
-   /* Counter is M2 based so it doesn't matter whether */
-   /* the PPU is in its VBlank period or not           */
-   UNUSED(vblank);
-
-   /* Increment the counter if it is enabled and check for strike */
-   if (irq.enabled)
-   {
-     /* Is there a constant for cycles per scanline? */
-     /* If so, someone ought to substitute it here   */
-     irq.counter = irq.counter + 114;
-
-     /* IRQ line is hooked to Q12 of the counter */
-     if (irq.counter & 0x1000)
-     {
-       /* Trigger the IRQ */
-       nes6502_irq ();
-
-       /* Reset the counter */
-       map50_irq_reset ();
-     }
-   }
+  /* Trigger the IRQ */
+  nes6502_irq ();
+
+  /* Reset the counter */
+  map50_irq_reset ();
 }
 
 /******************************************/
@@ -109,9 +98,13 @@ static void map50_write (uint32 address, uint8 value)
   /* A8 high = IRQ timer toggle */
   if (address & 0x100)
   {
-    /* IRQ settings */
-    if (value & 0x01) irq.enabled = true;
-    else              map50_irq_reset ();
+    /* IRQ settings, the IRQ line is hooked to Q12 of the M2 counter */
+    if (!(value & 0x01))   map50_irq_reset ();
+    else if (!irq.enabled)
+    {
+      irq.enabled = true;
+      nes_settimer (map50_timer, 0x1000);
+    }
   }
   else
   {
@@ -128,6 +121,22 @@ static void map50_write (uint32 address, uint8 value)
   return;
 }
 
+/* The counter runs as the NES timer, only the cycles left are saved */
+static void map50_getstate (void *state)
+{
+  ((mapper50Data*)state)->irqCounterEnabled = irq.enabled;
+  ((mapper50Data*)state)->irqCyclesLeft = irq.enabled ? nes_gettimer () : 0;
+}
+
+static void map50_setstate (void *state)
+{
+  irq.enabled = ((mapper50Data*)state)->irqCounterEnabled;
+  if (irq.enabled)
+    nes_settimer (map50_timer, ((mapper50Data*)state)->irqCyclesLeft);
+  else
+    nes_settimer (NULL, 0);
+}
+
 static mem_write_handler_t map50_memwrite [] =
 {
    { 0x4000, 0x5FFF, map50_write },
@@ -140,9 +149,9 @@ mapintf_t map50_intf =
    "SMB2j (3rd discovered variant)", /* Mapper name */
    map50_init,                       /* Initialization routine */
    NULL,                             /* VBlank callback */
-   map50_hblank,                     /* HBlank callback */
-   NULL,                             /* Get state (SNSS) */
-   NULL,                             /* Set state (SNSS) */
+   NULL,                             /* HBlank callback */
+   map50_getstate,                   /* Get state (SNSS) */
+   map50_setstate,                   /* Set state (SNSS) */
    NULL,                             /* Memory read structure */
    map50_memwrite,                   /* Memory write structure */
    NULL                              /* External sound device */
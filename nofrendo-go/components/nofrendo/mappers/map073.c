@@ -35,6 +35,12 @@ static struct
   uint32 counter;
 } irq;
 
+typedef struct
+{
+  unsigned char irqCounterEnabled;
+  unsigned short irqCounter;
+} mapper73Data;
+
 /**************************/
 /* Mapper #73: Salamander */
 /**************************/
@@ -51,32 +57,35 @@ static void map73_init (void)
 /****************************************/
 /* Mapper #73 callback for IRQ handling */
 /****************************************/
-static void map73_hblank (int vblank)
+static void map73_timer (void)
+{
+  /* Counter overflowed into Q16, clip to sixteen-bit word */
+  irq.counter = 0x0000;
+
+  /* Trigger the IRQ */
+  nes6502_irq ();
+
+  /* Shut off IRQ counter */
+  irq.enabled = false;
+}
+
+/*****************************************************/
+/* Mapper #73 counter is M2 based, it runs as timer  */
+/* while enabled and is only brought up to date when */
+/* the game changes it                               */
+/*****************************************************/
+static void map73_sync (void)
+{
+  if (irq.enabled)
+    irq.counter = (0x10000 - nes_gettimer ()) & 0xFFFF;
+}
+
+static void map73_schedule (void)
 {
-   /* Counter is M2 based so it doesn't matter whether */
-   /* the PPU is in its VBlank period or not           */
-   UNUSED (vblank);
-
-   /* Increment the counter if it is enabled and check for strike */
-   if (irq.enabled)
-   {
-     /* Is there a constant for cycles per scanline? */
-     /* If so, someone ought to substitute it here   */
-     irq.counter = irq.counter + 114;
-
-     /* Counter triggered on overflow into Q16 */
-     if (irq.counter & 0x10000)
-     {
-       /* Clip to sixteen-bit word */
-       irq.counter &= 0xFFFF;
-
-       /* Trigger the IRQ */
-       nes6502_irq ();
-
-       /* Shut off IRQ counter */
-       irq.enabled = false;
-     }
-   }
+  if (irq.enabled)
+    nes_settimer (map73_timer, 0x10000 - irq.counter);
+  else
+    nes_settimer (NULL, 0);
 }
 
 /******************************************/
@@ -84,6 +93,8 @@ static void map73_hblank (int vblank)
 /******************************************/
 static void map73_write (uint32 address, uint8 value)
 {
+  map73_sync ();
+
   switch (address & 0xF000)
   {
     case 0x8000: irq.counter &= 0xFFF0;
@@ -102,14 +113,30 @@ static void map73_write (uint32 address, uint8 value)
                  else              irq.enabled = false;
                  break;
     case 0xF000: mmc_bankrom (16, 0x8000, value);
-    default:     break;
+    default:     return;
   }
 
+  map73_schedule ();
+
   /* Done */
   return;
 }
 
 
+static void map73_getstate (void *state)
+{
+  map73_sync ();
+  ((mapper73Data*)state)->irqCounterEnabled = irq.enabled;
+  ((mapper73Data*)state)->irqCounter = irq.counter;
+}
+
+static void map73_setstate (void *state)
+{
+  irq.enabled = ((mapper73Data*)state)->irqCounterEnabled;
+  irq.counter = ((mapper73Data*)state)->irqCounter;
+  map73_schedule ();
+}
+
 static mem_write_handler_t map73_memwrite [] =
 {
    { 0x8000, 0xFFFF, map73_write },
@@ -122,9 +149,9 @@ mapintf_t map73_intf =
    "Konami VRC3",                    /* Mapper name */
    map73_init,                       /* Initialization routine */
    NULL,                             /* VBlank callback */
-   map73_hblank,                     /* HBlank callback */
-   NULL,                             /* Get state (SNSS) */
-   NULL,                             /* Set state (SNSS) */
+   NULL,                             /* HBlank callback */
+   map73_getstate,                   /* Get state (SNSS) */
+   map73_setstate,                   /* Set state (SNSS) */
    NULL,                             /* Memory read structure */
    map73_memwrite,                   /* Memory write structure */
    NULL                              /* External sound device */
@@ -34,6 +34,44 @@ static struct
    bool enabled;
 } irq;
 
+typedef struct
+{
+   unsigned char irqCounter;
+   unsigned char irqCounterEnabled;
+   unsigned char irqLatch;
+   unsigned char irqWaitState;
+} mapper85Data;
+
+/* The counter ticks once per scanline. While it's enabled it runs as the
+** NES timer instead, and is only brought up to date when we need it.
+*/
+static int map85_getcounter(void)
+{
+   float cycles_per_line = nes_getptr()->cycles_per_line;
+
+   if (!irq.enabled)
+      return irq.counter;
+
+   return MIN(255, 256 - (int)((nes_gettimer() + cycles_per_line - 1) / cycles_per_line));
+}
+
+static void map85_timer(void);
+
+static void map85_schedule(void)
+{
+   if (irq.enabled)
+      nes_settimer(map85_timer, (256 - irq.counter) * nes_getptr()->cycles_per_line);
+   else
+      nes_settimer(NULL, 0);
+}
+
+static void map85_timer(void)
+{
+   irq.counter = irq.latch;
+   nes6502_irq();
+   map85_schedule();
+}
+
 /* mapper 85: Konami VRC7 */
 static void map85_write(uint32 address, uint8 value)
 {
@@ -111,6 +149,7 @@ static void map85_write(uint32 address, uint8 value)
       break;
 
    case 0x0F:
+      irq.counter = map85_getcounter();
       if (0x10 == reg)
       {
          irq.enabled = irq.wait_state;
@@ -122,6 +161,7 @@ static void map85_write(uint32 address, uint8 value)
          if (true == irq.enabled)
             irq.counter = irq.latch;
       }
+      map85_schedule();
       break;
 
    default:
@@ -130,21 +170,21 @@ static void map85_write(uint32 address, uint8 value)
    }
 }
 
-static void map85_hblank(int vblank)
+static void map85_getstate(void *state)
 {
-   UNUSED(vblank);
-
-   if (irq.enabled)
-   {
-      if (++irq.counter > 0xFF)
-      {
-         irq.counter = irq.latch;
-         nes6502_irq();
+   ((mapper85Data*)state)->irqCounter = map85_getcounter();
+   ((mapper85Data*)state)->irqCounterEnabled = irq.enabled;
+   ((mapper85Data*)state)->irqLatch = irq.latch;
+   ((mapper85Data*)state)->irqWaitState = irq.wait_state;
+}
 
-         //return;
-      }
-      //irq.counter++;
-   }
+static void map85_setstate(void *state)
+{
+   irq.counter = ((mapper85Data*)state)->irqCounter;
+   irq.enabled = ((mapper85Data*)state)->irqCounterEnabled;
+   irq.latch = ((mapper85Data*)state)->irqLatch;
+   irq.wait_state = ((mapper85Data*)state)->irqWaitState;
+   map85_schedule();
 }
 
 static mem_write_handler_t map85_memwrite[] =
@@ -171,9 +211,9 @@ mapintf_t map85_intf =
    "Konami VRC7", /* mapper name */
    map85_init, /* init routine */
    NULL, /* vblank callback */
-   map85_hblank, /* hblank callback */
-   NULL, /* get state (snss) */
-   NULL, /* set state (snss) */
+   NULL, /* hblank callback */
+   map85_getstate, /* get state (snss) */
+   map85_setstate, /* set state (snss) */
    NULL, /* memory read structure */
    map85_memwrite, /* memory write structure */
    NULL
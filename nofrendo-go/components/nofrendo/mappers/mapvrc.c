@@ -59,6 +59,38 @@ static void vrc_init(void)
    irq.latch = irq.wait_state = 0;
 }
 
+/* The counter ticks once per scanline. While it's enabled it runs as the
+** NES timer instead, and is only brought up to date when we need it.
+*/
+static int vrc_getcounter(void)
+{
+   float cycles_per_line = nes_getptr()->cycles_per_line;
+
+   if (!irq.enabled)
+      return irq.counter;
+
+   return MIN(255, 256 - (int)((nes_gettimer() + cycles_per_line - 1) / cycles_per_line));
+}
+
+static void vrc_timer(void);
+
+static void vrc_schedule(void)
+{
+   if (irq.enabled)
+      nes_settimer(vrc_timer, (256 - irq.counter) * nes_getptr()->cycles_per_line);
+   else
+      nes_settimer(NULL, 0);
+}
+
+static void vrc_timer(void)
+{
+   irq.counter = irq.latch;
+   nes6502_irq();
+   //irq.enabled = false;
+   irq.enabled = irq.wait_state;
+   vrc_schedule();
+}
+
 static void map21_write(uint32 address, uint8 value)
 {
    switch (address)
@@ -148,11 +180,14 @@ static void map21_write(uint32 address, uint8 value)
       irq.enabled = (value >> 1) & 0x01;
       irq.wait_state = value & 0x01;
       irq.counter = irq.latch;
+      vrc_schedule();
       break;
    case 0xF006:
    case 0xF003:
    case 0xF0C0:
+      irq.counter = vrc_getcounter();
       irq.enabled = irq.wait_state;
+      vrc_schedule();
       break;
 
    default:
@@ -291,10 +326,13 @@ static void map23_write(uint32 address, uint8 value)
       irq.enabled = (value >> 1) & 0x01;
       irq.wait_state = value & 0x01;
       irq.counter = irq.latch;
+      vrc_schedule();
       break;
 
    case 0xF00C:
+      irq.counter = vrc_getcounter();
       irq.enabled = irq.wait_state;
+      vrc_schedule();
       break;
 
    default:
@@ -303,21 +341,6 @@ static void map23_write(uint32 address, uint8 value)
    }
 }
 
-static void vrc_hblank(int vblank)
-{
-   UNUSED(vblank);
-
-   if (irq.enabled)
-   {
-      if (256 == ++irq.counter)
-      {
-         irq.counter = irq.latch;
-         nes6502_irq();
-         //irq.enabled = false;
-         irq.enabled = irq.wait_state;
-      }
-   }
-}
 
 
 
@@ -341,7 +364,7 @@ static mem_write_handler_t map23_memwrite[] =
 
 static void map21_getstate(void *state)
 {
-   ((mapper21Data*)state)->irqCounter = irq.counter;
+   ((mapper21Data*)state)->irqCounter = vrc_getcounter();
    ((mapper21Data*)state)->irqCounterEnabled = irq.enabled;
 }
 
@@ -349,6 +372,7 @@ static void map21_setstate(void *state)
 {
    irq.counter = ((mapper21Data*)state)->irqCounter;
    irq.enabled = ((mapper21Data*)state)->irqCounterEnabled;
+   vrc_schedule();
 }
 
 mapintf_t map21_intf =
@@ -357,7 +381,7 @@ mapintf_t map21_intf =
    "Konami VRC4 A", /* mapper name */
    vrc_init, /* init routine */
    NULL, /* vblank callback */
-   vrc_hblank, /* hblank callback */
+   NULL, /* hblank callback */
    map21_getstate, /* get state (snss) */
    map21_setstate, /* set state (snss) */
    NULL, /* memory read structure */
@@ -385,9 +409,9 @@ mapintf_t map23_intf =
    "Konami VRC2 B", /* mapper name */
    vrc_init, /* init routine */
    NULL, /* vblank callback */
-   vrc_hblank, /* hblank callback */
-   NULL, /* get state (snss) */
-   NULL, /* set state (snss) */
+   NULL, /* hblank callback */
+   map21_getstate, /* get state (snss) */
+   map21_setstate, /* set state (snss) */
    NULL, /* memory read structure */
    map23_memwrite, /* memory write structure */
    NULL /* external sound device */
@@ -399,9 +423,9 @@ mapintf_t map25_intf =
    "Konami VRC4 B", /* mapper name */
    NULL, /* init routine */
    NULL, /* vblank callback */
-   vrc_hblank, /* hblank callback */
-   NULL, /* get state (snss) */
-   NULL, /* set state (snss) */
+   NULL, /* hblank callback */
+   map21_getstate, /* get state (snss) */
+   map21_setstate, /* set state (snss) */
    NULL, /* memory read structure */
    map21_memwrite, /* memory write structure */
    NULL /* external sound device */
@@ -38,6 +38,61 @@ nes_t *nes_getptr(void)
    return &nes;
 }
 
+/* Schedule func to be called once the CPU has run for the given number
+** of cycles. The CPU timeslices are cut at that point, so mappers that
+** count M2 cycles get their IRQ on the right cycle instead of on the next
+** scanline. There's only one timer, a NULL func disarms it.
+*/
+void nes_settimer(nes_timer_t func, int cycles)
+{
+   nes.timer_func = func;
+   nes.timer_cycle = nes6502_getcycles() + MAX(cycles, 0);
+
+   /* If we're called from a memory handler the current timeslice may run past the new deadline */
+   nes6502_release();
+}
+
+/* Cycles left before the timer is due */
+int nes_gettimer(void)
+{
+   if (NULL == nes.timer_func)
+      return 0;
+
+   return MAX((int32)(nes.timer_cycle - nes6502_getcycles()), 0);
+}
+
+/* Run the CPU for the rest of the scanline, stopping at the timer if any */
+INLINE void runcpu(void)
+{
+   int elapsed_cycles, timeslice;
+
+   while (true)
+   {
+      if (nes.timer_func && (int32)(nes.timer_cycle - nes6502_getcycles()) <= 0)
+      {
+         nes_timer_t func = nes.timer_func;
+         nes.timer_func = NULL;
+         func();
+         continue;
+      }
+
+      timeslice = nes.cycles;
+
+      if (nes.timer_func)
+         timeslice = MIN(timeslice, (int32)(nes.timer_cycle - nes6502_getcycles()));
+
+      if (timeslice <= 0)
+         break;
+
+      elapsed_cycles = nes6502_execute(timeslice);
+      apu_fc_advance(elapsed_cycles);
+      nes.cycles -= elapsed_cycles;
+
+      if (0 == elapsed_cycles)
+         break;
+   }
+}
+
 /* Emulate one frame */
 INLINE void renderframe()
 {
@@ -66,9 +121,7 @@ INLINE void renderframe()
       if (mapintf->hblank)
          mapintf->hblank(nes.scanline);
 
-      elapsed_cycles = nes6502_execute(nes.cycles);
-      apu_fc_advance(elapsed_cycles);
-      nes.cycles -= elapsed_cycles;
+      runcpu();
 
       ppu_endscanline();
       nes.scanline++;
@@ -81,6 +134,7 @@ INLINE void renderframe()
 void nes_emulate(void)
 {
    const int audioSamples = nes.apu->sample_rate / nes.refresh_rate;
+   int frames = 0;
 
    // Discard the garbage frames
    renderframe();
@@ -93,9 +147,18 @@ void nes_emulate(void)
       osd_getinput();
       renderframe();
 
-      if (nes.drawframe)
+      if (++frames % nes.refresh_rate == 0)
+      {
+#ifdef NOFRENDO_DEBUG
+         MESSAGE_DEBUG("Memory handler dispatches per frame: %d\n", nes.mem->dispatches / nes.refresh_rate);
+         nes.mem->dispatches = 0;
+         mmc_cachestats();
+#endif
+      }
+
+      /* a bitmap that wasn't shown is drawn over by the next frame */
+      if (nes.drawframe && osd_blitscreen(nes.vidbuf))
       {
-         osd_blitscreen(nes.vidbuf);
          nes.vidbuf = (nes.vidbuf == framebuffers[1]) ? framebuffers[0] : framebuffers[1];
       }
 
@@ -150,6 +213,8 @@ void nes_reset(reset_type_t reset_type)
       memset(nes.rominfo->vram, 0, 0x2000 * nes.rominfo->vram_banks);
    }
 
+   nes.timer_func = NULL;
+
    apu_reset();
    ppu_reset();
    mem_reset();
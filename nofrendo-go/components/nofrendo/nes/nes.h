@@ -59,6 +59,9 @@ typedef enum
    ZERO_RESET,
 } reset_type_t;
 
+/* Mapper timer callback, see nes_settimer() */
+typedef void (*nes_timer_t)(void);
+
 typedef struct nes_s
 {
    /* Hardware */
@@ -86,6 +89,10 @@ typedef struct nes_s
    short scanline;
    float cycles;
 
+   /* Mapper timer, due when the CPU reaches timer_cycle */
+   nes_timer_t timer_func;
+   uint32 timer_cycle;
+
    /* Control */
    bool autoframeskip;
    bool poweroff;
@@ -103,5 +110,7 @@ extern void nes_emulate(void);
 extern void nes_reset(reset_type_t reset_type);
 extern void nes_poweroff(void);
 extern void nes_togglepause(void);
+extern void nes_settimer(nes_timer_t func, int cycles);
+extern int  nes_gettimer(void);
 
 #endif /* _NES_H_ */
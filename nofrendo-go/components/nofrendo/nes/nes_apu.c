@@ -29,17 +29,29 @@
 
 #include <esp_attr.h>
 #include <string.h>
-
-#define APU_OVERSAMPLE
-#define APU_VOLUME_DECAY(x)  ((x) -= ((x) >> 7))
+#include <math.h>
 
 /* the following seem to be the correct (empirically determined)
-** relative volumes between the sound channels
+** relative volumes between the sound channels, in quarters
+*/
+#define APU_RECTANGLE_MIX  4
+#define APU_TRIANGLE_MIX   5
+#define APU_NOISE_MIX      3
+#define APU_DMC_MIX        3
+
+/* Band-limited step synthesis
+** ===========================
+** The channels are stepped in cpu cycles and never render samples themselves.
+** Whenever the output of a channel changes, the delta is added to blip_buf at
+** the exact (fractional) sample position of that cycle, spread over BLIP_WIDTH
+** samples by a windowed sinc kernel. apu_process() then only has to integrate
+** the buffer once per frame.
 */
-#define APU_RECTANGLE_OUTPUT(channel) (apu.rectangle[channel].output_vol)
-#define APU_TRIANGLE_OUTPUT           (apu.triangle.output_vol + (apu.triangle.output_vol >> 2))
-#define APU_NOISE_OUTPUT              ((apu.noise.output_vol + apu.noise.output_vol + apu.noise.output_vol) >> 2)
-#define APU_DMC_OUTPUT                ((apu.dmc.output_vol + apu.dmc.output_vol + apu.dmc.output_vol) >> 2)
+#define BLIP_PHASE_BITS   5
+#define BLIP_PHASES       (1 << BLIP_PHASE_BITS)
+#define BLIP_WIDTH        8
+#define BLIP_KERNEL_BITS  15
+#define BLIP_BUFFER_SIZE  2048
 
 /* Runtime settings */
 #define OPT(n) (apu.options[(n)])
@@ -47,17 +59,33 @@
 /* active APU */
 static apu_t apu;
 
+/* timing and synthesis state, not part of the saved context */
+static struct
+{
+   uint32 cycles;          /* cpu cycle the channels have been run up to */
+   uint32 base_cycle;      /* cpu cycle (and ticks fraction) of blip_buf[0] */
+   uint32 base_frac;
+   uint32 ticks_per_cycle; /* ticks make both the frame and quarter frame integers */
+   uint32 frame_ticks;
+   uint32 quarter_ticks;
+   int32 seq_ticks;        /* ticks left before the next quarter frame clock */
+   uint32 seq_step;
+   uint64_t factor;        /* output samples per tick, 16.48 fixed point */
+   int32 max_ticks;        /* deltas past that point would overflow blip_buf */
+   int num_samples;        /* samples per frame the factor was computed for */
+   int used;               /* highest blip_buf entry touched + 1 */
+   int32 level;            /* integrator */
+   int32 prev_sample;      /* filter */
+} blip;
+
+static int16 blip_kernel[BLIP_PHASES][BLIP_WIDTH];
+static int32 blip_buf[BLIP_BUFFER_SIZE + BLIP_WIDTH];
+
 /* look up table madness */
 static int32 decay_lut[16];
 static int32 vbl_lut[32];
 static int32 trilength_lut[128];
 
-/* noise lookups for both modes */
-#ifndef REALTIME_NOISE
-static int8 noise_long_lut[APU_NOISE_32K];
-static int8 noise_short_lut[APU_NOISE_93];
-#endif /* !REALTIME_NOISE */
-
 /* vblank length table used for rectangles, triangle, noise */
 DRAM_ATTR static const uint8 vbl_length[32] =
 {
@@ -103,6 +131,13 @@ DRAM_ATTR static const int16 dmc_clocks[16] =
 DRAM_ATTR static const int16 duty_flip[4] = { 2, 4, 8, 12 };
 
 
+/* mixing weight of each channel, in the same order as APU_CHANNELx_EN */
+DRAM_ATTR static const int8 channel_mix[5] =
+{
+   APU_RECTANGLE_MIX, APU_RECTANGLE_MIX, APU_TRIANGLE_MIX, APU_NOISE_MIX, APU_DMC_MIX
+};
+
+
 IRAM_ATTR void apu_fc_advance(int cycles)
 {
    // https://wiki.nesdev.com/w/index.php/APU_Frame_Counter
@@ -138,11 +173,46 @@ void apu_getcontext(apu_t *dest_apu)
    *dest_apu = apu;
 }
 
+/* Place a band-limited step of amplitude delta at the given cpu cycle */
+INLINE void blip_add_delta(uint32 cycle, int32 delta)
+{
+   int32 ticks = (cycle - blip.base_cycle) * blip.ticks_per_cycle - blip.base_frac;
+
+   if (ticks < 0)
+      ticks = 0;
+   else if (ticks >= blip.max_ticks)
+      return;
+
+   uint32 pos = (ticks * blip.factor) >> 32;
+   int index = pos >> 16;
+   const int16 *kernel = blip_kernel[(pos >> (16 - BLIP_PHASE_BITS)) & (BLIP_PHASES - 1)];
+   int32 *out = blip_buf + index;
+
+   for (int i = 0; i < BLIP_WIDTH; i++)
+      out[i] += delta * kernel[i];
+
+   if (index + BLIP_WIDTH > blip.used)
+      blip.used = index + BLIP_WIDTH;
+}
+
+/* Update the output level of a channel, generating a step if it changed */
+INLINE void apu_output(int chan, int32 *output_vol, int32 value, uint32 cycle)
+{
+   int32 delta = value - *output_vol;
+
+   if (0 == delta)
+      return;
+
+   *output_vol = value;
+
+   if (OPT(APU_CHANNEL1_EN + chan))
+      blip_add_delta(cycle, (delta * channel_mix[chan]) >> 2);
+}
+
 /* emulation of the 15-bit shift register the
 ** NES uses to generate pseudo-random series
 ** for the white noise channel
 */
-#ifdef REALTIME_NOISE
 INLINE int8 shift_register15(uint8 xor_tap)
 {
    static int sreg = 0x4000;
@@ -155,38 +225,6 @@ INLINE int8 shift_register15(uint8 xor_tap)
    sreg |= (bit14 << 14);
    return (bit0 ^ 1);
 }
-#else /* !REALTIME_NOISE */
-static void shift_register15(int8 *buf, int count)
-{
-   static int sreg = 0x4000;
-   int bit0, bit1, bit6, bit14;
-
-   if (count == APU_NOISE_93)
-   {
-      while (count--)
-      {
-         bit0 = sreg & 1;
-         bit6 = (sreg & 0x40) >> 6;
-         bit14 = (bit0 ^ bit6);
-         sreg >>= 1;
-         sreg |= (bit14 << 14);
-         *buf++ = bit0 ^ 1;
-      }
-   }
-   else /* 32K noise */
-   {
-      while (count--)
-      {
-         bit0 = sreg & 1;
-         bit1 = (sreg & 2) >> 1;
-         bit14 = (bit0 ^ bit1);
-         sreg >>= 1;
-         sreg |= (bit14 << 14);
-         *buf++ = bit0 ^ 1;
-      }
-   }
-}
-#endif /* !REALTIME_NOISE */
 
 /* RECTANGLE WAVE
 ** ==============
@@ -195,172 +233,98 @@ static void shift_register15(int8 *buf, int count)
 ** reg2: 8 bits of freq
 ** reg3: 0-2=high freq, 7-4=vbl length counter
 */
-#ifdef APU_OVERSAMPLE
-
-#define  APU_MAKE_RECTANGLE(ch) \
-INLINE int32 apu_rectangle_##ch(void) \
-{ \
-   int32 output, total; \
-   int num_times; \
-\
-   APU_VOLUME_DECAY(apu.rectangle[ch].output_vol); \
-\
-   if (false == apu.rectangle[ch].enabled || 0 == apu.rectangle[ch].vbl_length) \
-      return APU_RECTANGLE_OUTPUT(ch); \
-\
-   /* vbl length counter */ \
-   if (false == apu.rectangle[ch].holdnote) \
-      apu.rectangle[ch].vbl_length--; \
-\
-   /* envelope decay at a rate of (env_delay + 1) / 240 secs */ \
-   apu.rectangle[ch].env_phase -= 4; /* 240/60 */ \
-   while (apu.rectangle[ch].env_phase < 0) \
-   { \
-      apu.rectangle[ch].env_phase += apu.rectangle[ch].env_delay; \
-\
-      if (apu.rectangle[ch].holdnote) \
-         apu.rectangle[ch].env_vol = (apu.rectangle[ch].env_vol + 1) & 0x0F; \
-      else if (apu.rectangle[ch].env_vol < 0x0F) \
-         apu.rectangle[ch].env_vol++; \
-   } \
-\
-   /* TODO: find true relation of freq_limit to register values */ \
-   if (apu.rectangle[ch].freq < 8 \
-       || (false == apu.rectangle[ch].sweep_inc \
-           && apu.rectangle[ch].freq > apu.rectangle[ch].freq_limit)) \
-      return APU_RECTANGLE_OUTPUT(ch); \
-\
-   /* frequency sweeping at a rate of (sweep_delay + 1) / 120 secs */ \
-   if (apu.rectangle[ch].sweep_on && apu.rectangle[ch].sweep_shifts) \
-   { \
-      apu.rectangle[ch].sweep_phase -= 2; /* 120/60 */ \
-      while (apu.rectangle[ch].sweep_phase < 0) \
-      { \
-         apu.rectangle[ch].sweep_phase += apu.rectangle[ch].sweep_delay; \
-\
-         if (apu.rectangle[ch].sweep_inc) /* ramp up */ \
-         { \
-            if (0 == ch) \
-               apu.rectangle[ch].freq += ~(apu.rectangle[ch].freq >> apu.rectangle[ch].sweep_shifts); \
-            else \
-               apu.rectangle[ch].freq -= (apu.rectangle[ch].freq >> apu.rectangle[ch].sweep_shifts); \
-         } \
-         else /* ramp down */ \
-         { \
-            apu.rectangle[ch].freq += (apu.rectangle[ch].freq >> apu.rectangle[ch].sweep_shifts); \
-         } \
-      } \
-   } \
-\
-   apu.rectangle[ch].accum -= apu.cycle_rate; \
-   if (apu.rectangle[ch].accum >= 0) \
-      return APU_RECTANGLE_OUTPUT(ch); \
-\
-   if (apu.rectangle[ch].fixed_envelope) \
-      output = apu.rectangle[ch].volume << 8; /* fixed volume */ \
-   else \
-      output = (apu.rectangle[ch].env_vol ^ 0x0F) << 8; \
-\
-   num_times = total = 0; \
-\
-   while (apu.rectangle[ch].accum < 0) \
-   { \
-      apu.rectangle[ch].accum += apu.rectangle[ch].freq + 1; \
-      apu.rectangle[ch].adder = (apu.rectangle[ch].adder + 1) & 0x0F; \
-\
-      if (apu.rectangle[ch].adder < apu.rectangle[ch].duty_flip) \
-         total += output; \
-      else \
-         total -= output; \
-\
-      num_times++; \
-   } \
-\
-   apu.rectangle[ch].output_vol = total / num_times; \
-   return APU_RECTANGLE_OUTPUT(ch); \
+INLINE bool apu_rectangle_audible(rectangle_t *rect)
+{
+   /* TODO: find true relation of freq_limit to register values */
+   return rect->enabled && rect->vbl_length && rect->freq >= 8
+      && (rect->sweep_inc || rect->freq <= rect->freq_limit);
 }
 
-#else /* !APU_OVERSAMPLE */
-#define  APU_MAKE_RECTANGLE(ch) \
-INLINE int32 apu_rectangle_##ch(void) \
-{ \
-   int32 output; \
-\
-   APU_VOLUME_DECAY(apu.rectangle[ch].output_vol); \
-\
-   if (false == apu.rectangle[ch].enabled || 0 == apu.rectangle[ch].vbl_length) \
-      return APU_RECTANGLE_OUTPUT(ch); \
-\
-   /* vbl length counter */ \
-   if (false == apu.rectangle[ch].holdnote) \
-      apu.rectangle[ch].vbl_length--; \
-\
-   /* envelope decay at a rate of (env_delay + 1) / 240 secs */ \
-   apu.rectangle[ch].env_phase -= 4; /* 240/60 */ \
-   while (apu.rectangle[ch].env_phase < 0) \
-   { \
-      apu.rectangle[ch].env_phase += apu.rectangle[ch].env_delay; \
-\
-      if (apu.rectangle[ch].holdnote) \
-         apu.rectangle[ch].env_vol = (apu.rectangle[ch].env_vol + 1) & 0x0F; \
-      else if (apu.rectangle[ch].env_vol < 0x0F) \
-         apu.rectangle[ch].env_vol++; \
-   } \
-\
-   /* TODO: find true relation of freq_limit to register values */ \
-   if (apu.rectangle[ch].freq < 8 || (false == apu.rectangle[ch].sweep_inc && apu.rectangle[ch].freq > apu.rectangle[ch].freq_limit)) \
-      return APU_RECTANGLE_OUTPUT(ch); \
-\
-   /* frequency sweeping at a rate of (sweep_delay + 1) / 120 secs */ \
-   if (apu.rectangle[ch].sweep_on && apu.rectangle[ch].sweep_shifts) \
-   { \
-      apu.rectangle[ch].sweep_phase -= 2; /* 120/60 */ \
-      while (apu.rectangle[ch].sweep_phase < 0) \
-      { \
-         apu.rectangle[ch].sweep_phase += apu.rectangle[ch].sweep_delay; \
-\
-         if (apu.rectangle[ch].sweep_inc) /* ramp up */ \
-         { \
-            if (0 == ch) \
-               apu.rectangle[ch].freq += ~(apu.rectangle[ch].freq >> apu.rectangle[ch].sweep_shifts); \
-            else \
-               apu.rectangle[ch].freq -= (apu.rectangle[ch].freq >> apu.rectangle[ch].sweep_shifts); \
-         } \
-         else /* ramp down */ \
-         { \
-            apu.rectangle[ch].freq += (apu.rectangle[ch].freq >> apu.rectangle[ch].sweep_shifts); \
-         } \
-      } \
-   } \
-\
-   apu.rectangle[ch].accum -= apu.cycle_rate; \
-   if (apu.rectangle[ch].accum >= 0) \
-      return APU_RECTANGLE_OUTPUT(ch); \
-\
-   while (apu.rectangle[ch].accum < 0) \
-   { \
-      apu.rectangle[ch].accum += (apu.rectangle[ch].freq + 1); \
-      apu.rectangle[ch].adder = (apu.rectangle[ch].adder + 1) & 0x0F; \
-   } \
-\
-   if (apu.rectangle[ch].fixed_envelope) \
-      output = apu.rectangle[ch].volume << 8; /* fixed volume */ \
-   else \
-      output = (apu.rectangle[ch].env_vol ^ 0x0F) << 8; \
-\
-   if (0 == apu.rectangle[ch].adder) \
-      apu.rectangle[ch].output_vol = output; \
-   else if (apu.rectangle[ch].adder == apu.rectangle[ch].duty_flip) \
-      apu.rectangle[ch].output_vol = -output; \
-\
-   return APU_RECTANGLE_OUTPUT(ch); \
+INLINE int32 apu_rectangle_level(rectangle_t *rect)
+{
+   int32 output;
+
+   if (!apu_rectangle_audible(rect))
+      return 0;
+
+   if (rect->fixed_envelope)
+      output = rect->volume << 8; /* fixed volume */
+   else
+      output = (rect->env_vol ^ 0x0F) << 8;
+
+   return (rect->adder < rect->duty_flip) ? output : -output;
 }
 
-#endif /* !APU_OVERSAMPLE */
+INLINE void apu_rectangle(int ch, uint32 cycle, int32 cycles)
+{
+   rectangle_t *rect = &apu.rectangle[ch];
+
+   if (!apu_rectangle_audible(rect))
+      return;
+
+   while (rect->timer <= cycles)
+   {
+      cycle += rect->timer;
+      cycles -= rect->timer;
+
+      rect->timer = rect->freq + 1;
+      rect->adder = (rect->adder + 1) & 0x0F;
+
+      if (0 == rect->adder || rect->adder == rect->duty_flip)
+         apu_output(ch, &rect->output_vol, apu_rectangle_level(rect), cycle);
+   }
+
+   rect->timer -= cycles;
+}
+
+/* envelope decay at a rate of (env_delay + 1) / 240 secs */
+INLINE void apu_rectangle_quarter(rectangle_t *rect)
+{
+   if (false == rect->enabled || 0 == rect->vbl_length)
+      return;
+
+   if (--rect->env_phase < 0)
+   {
+      rect->env_phase += rect->env_delay;
+
+      if (rect->holdnote)
+         rect->env_vol = (rect->env_vol + 1) & 0x0F;
+      else if (rect->env_vol < 0x0F)
+         rect->env_vol++;
+   }
+}
+
+/* vbl length counter and frequency sweeping at a rate of (sweep_delay + 1) / 120 secs */
+INLINE void apu_rectangle_half(int ch)
+{
+   rectangle_t *rect = &apu.rectangle[ch];
+
+   if (false == rect->enabled || 0 == rect->vbl_length)
+      return;
 
-/* generate the functions */
-APU_MAKE_RECTANGLE(0)
-APU_MAKE_RECTANGLE(1)
+   if (false == rect->holdnote)
+      rect->vbl_length--;
+
+   if (!apu_rectangle_audible(rect))
+      return;
+
+   if (rect->sweep_on && rect->sweep_shifts && --rect->sweep_phase < 0)
+   {
+      rect->sweep_phase += rect->sweep_delay;
+
+      if (rect->sweep_inc) /* ramp up */
+      {
+         if (0 == ch)
+            rect->freq += ~(rect->freq >> rect->sweep_shifts);
+         else
+            rect->freq -= (rect->freq >> rect->sweep_shifts);
+      }
+      else /* ramp down */
+      {
+         rect->freq += (rect->freq >> rect->sweep_shifts);
+      }
+   }
+}
 
 
 /* TRIANGLE WAVE
@@ -369,42 +333,59 @@ APU_MAKE_RECTANGLE(1)
 ** reg2: low 8 bits of frequency
 ** reg3: 7-3=length counter, 2-0=high 3 bits of frequency
 */
-INLINE int32 apu_triangle(void)
+INLINE void apu_triangle(uint32 cycle, int32 cycles)
 {
-   APU_VOLUME_DECAY(apu.triangle.output_vol);
+   triangle_t *tri = &apu.triangle;
 
-   if (false == apu.triangle.enabled || 0 == apu.triangle.vbl_length)
-      return APU_TRIANGLE_OUTPUT;
+   if (false == tri->enabled || 0 == tri->vbl_length)
+      return;
 
-   if (apu.triangle.counter_started)
-   {
-      if (apu.triangle.linear_length > 0)
-         apu.triangle.linear_length--;
-      if (apu.triangle.vbl_length && false == apu.triangle.holdnote)
-         apu.triangle.vbl_length--;
-   }
-   else if (false == apu.triangle.holdnote && apu.triangle.write_latency)
+   if (0 == tri->linear_length || tri->freq < 4) /* inaudible */
+      return;
+
+   while (tri->timer <= cycles)
    {
-      if (--apu.triangle.write_latency == 0)
-         apu.triangle.counter_started = true;
+      cycle += tri->timer;
+      cycles -= tri->timer;
+
+      tri->timer = tri->freq;
+      tri->adder = (tri->adder + 1) & 0x1F;
+
+      if (tri->adder & 0x10)
+         apu_output(2, &tri->output_vol, tri->output_vol - (2 << 8), cycle);
+      else
+         apu_output(2, &tri->output_vol, tri->output_vol + (2 << 8), cycle);
    }
 
-   if (0 == apu.triangle.linear_length || apu.triangle.freq < 4) /* inaudible */
-      return APU_TRIANGLE_OUTPUT;
+   tri->timer -= cycles;
+}
 
-   apu.triangle.accum -= apu.cycle_rate; \
-   while (apu.triangle.accum < 0)
-   {
-      apu.triangle.accum += apu.triangle.freq;
-      apu.triangle.adder = (apu.triangle.adder + 1) & 0x1F;
+/* linear length counter, clocked at 240Hz */
+INLINE void apu_triangle_quarter(void)
+{
+   triangle_t *tri = &apu.triangle;
 
-      if (apu.triangle.adder & 0x10)
-         apu.triangle.output_vol -= (2 << 8);
-      else
-         apu.triangle.output_vol += (2 << 8);
+   if (false == tri->enabled || 0 == tri->vbl_length)
+      return;
+
+   if (tri->counter_started)
+   {
+      if (tri->linear_length > 0)
+         tri->linear_length--;
    }
+   else if (false == tri->holdnote && tri->write_latency)
+   {
+      if (--tri->write_latency == 0)
+         tri->counter_started = true;
+   }
+}
 
-   return APU_TRIANGLE_OUTPUT;
+INLINE void apu_triangle_half(void)
+{
+   triangle_t *tri = &apu.triangle;
+
+   if (tri->enabled && tri->counter_started && tri->vbl_length && false == tri->holdnote)
+      tri->vbl_length--;
 }
 
 
@@ -414,123 +395,60 @@ INLINE int32 apu_triangle(void)
 ** reg2: 7=small(93 byte) sample,3-0=freq lookup
 ** reg3: 7-4=vbl length counter
 */
-/* TODO: AAAAAAAAAAAAAAAAAAAAAAAA!  #ifdef MADNESS! */
-INLINE int32 apu_noise(void)
+INLINE int32 apu_noise_level(bool bit)
 {
    int32 outvol;
 
-#if defined(APU_OVERSAMPLE) && defined(REALTIME_NOISE)
-#else /* !(APU_OVERSAMPLE && REALTIME_NOISE) */
-   int32 noise_bit;
-#endif /* !(APU_OVERSAMPLE && REALTIME_NOISE) */
-#ifdef APU_OVERSAMPLE
-   int num_times;
-   int32 total;
-#endif /* APU_OVERSAMPLE */
-
-   APU_VOLUME_DECAY(apu.noise.output_vol);
-
    if (false == apu.noise.enabled || 0 == apu.noise.vbl_length)
-      return APU_NOISE_OUTPUT;
+      return 0;
 
-   /* vbl length counter */
-   if (false == apu.noise.holdnote)
-      apu.noise.vbl_length--;
-
-   /* envelope decay at a rate of (env_delay + 1) / 240 secs */
-   apu.noise.env_phase -= 4; /* 240/60 */
-   while (apu.noise.env_phase < 0)
-   {
-      apu.noise.env_phase += apu.noise.env_delay;
-
-      if (apu.noise.holdnote)
-         apu.noise.env_vol = (apu.noise.env_vol + 1) & 0x0F;
-      else if (apu.noise.env_vol < 0x0F)
-         apu.noise.env_vol++;
-   }
-
-   apu.noise.accum -= apu.cycle_rate;
-   if (apu.noise.accum >= 0)
-      return APU_NOISE_OUTPUT;
-
-#ifdef APU_OVERSAMPLE
    if (apu.noise.fixed_envelope)
       outvol = apu.noise.volume << 8; /* fixed volume */
    else
       outvol = (apu.noise.env_vol ^ 0x0F) << 8;
 
-   num_times = total = 0;
-#endif /* APU_OVERSAMPLE */
-
-   while (apu.noise.accum < 0)
-   {
-      apu.noise.accum += apu.noise.freq;
+   return bit ? outvol : -outvol;
+}
 
-#ifdef REALTIME_NOISE
+INLINE void apu_noise(uint32 cycle, int32 cycles)
+{
+   if (false == apu.noise.enabled || 0 == apu.noise.vbl_length)
+      return;
 
-#ifdef APU_OVERSAMPLE
-      if (shift_register15(apu.noise.xor_tap))
-         total += outvol;
-      else
-         total -= outvol;
+   while (apu.noise.timer <= cycles)
+   {
+      cycle += apu.noise.timer;
+      cycles -= apu.noise.timer;
 
-      num_times++;
-#else /* !APU_OVERSAMPLE */
-      noise_bit = shift_register15(apu.noise.xor_tap);
-#endif /* !APU_OVERSAMPLE */
+      apu.noise.timer = apu.noise.freq;
 
-#else /* !REALTIME_NOISE */
-      apu.noise.cur_pos++;
+      apu_output(3, &apu.noise.output_vol, apu_noise_level(shift_register15(apu.noise.xor_tap)), cycle);
+   }
 
-      if (apu.noise.short_sample)
-      {
-         if (APU_NOISE_93 == apu.noise.cur_pos)
-            apu.noise.cur_pos = 0;
-      }
-      else
-      {
-         if (APU_NOISE_32K == apu.noise.cur_pos)
-            apu.noise.cur_pos = 0;
-      }
+   apu.noise.timer -= cycles;
+}
 
-#ifdef APU_OVERSAMPLE
-      if (apu.noise.short_sample)
-         noise_bit = noise_short_lut[apu.noise.cur_pos];
-      else
-         noise_bit = noise_long_lut[apu.noise.cur_pos];
+/* envelope decay at a rate of (env_delay + 1) / 240 secs */
+INLINE void apu_noise_quarter(void)
+{
+   if (false == apu.noise.enabled || 0 == apu.noise.vbl_length)
+      return;
 
-      if (noise_bit)
-         total += outvol;
-      else
-         total -= outvol;
+   if (--apu.noise.env_phase < 0)
+   {
+      apu.noise.env_phase += apu.noise.env_delay;
 
-      num_times++;
-#endif /* APU_OVERSAMPLE */
-#endif /* !REALTIME_NOISE */
+      if (apu.noise.holdnote)
+         apu.noise.env_vol = (apu.noise.env_vol + 1) & 0x0F;
+      else if (apu.noise.env_vol < 0x0F)
+         apu.noise.env_vol++;
    }
+}
 
-#ifdef APU_OVERSAMPLE
-   apu.noise.output_vol = total / num_times;
-#else /* !APU_OVERSAMPLE */
-   if (apu.noise.fixed_envelope)
-      outvol = apu.noise.volume << 8; /* fixed volume */
-   else
-      outvol = (apu.noise.env_vol ^ 0x0F) << 8;
-
-#ifndef REALTIME_NOISE
-   if (apu.noise.short_sample)
-      noise_bit = noise_short_lut[apu.noise.cur_pos];
-   else
-      noise_bit = noise_long_lut[apu.noise.cur_pos];
-#endif /* !REALTIME_NOISE */
-
-   if (noise_bit)
-      apu.noise.output_vol = outvol;
-   else
-      apu.noise.output_vol = -outvol;
-#endif /* !APU_OVERSAMPLE */
-
-   return APU_NOISE_OUTPUT;
+INLINE void apu_noise_half(void)
+{
+   if (apu.noise.enabled && apu.noise.vbl_length && false == apu.noise.holdnote)
+      apu.noise.vbl_length--;
 }
 
 
@@ -548,81 +466,143 @@ INLINE void apu_dmcreload(void)
 ** reg2: 8 bits of 64-byte aligned address offset : $C000 + (value * 64)
 ** reg3: length, (value * 16) + 1
 */
-INLINE int32 apu_dmc(void)
+INLINE void apu_dmc(uint32 cycle, int32 cycles)
 {
    int delta_bit;
 
-   APU_VOLUME_DECAY(apu.dmc.output_vol);
-
    /* only process when channel is alive */
-   if (apu.dmc.dma_length)
+   if (0 == apu.dmc.dma_length)
+      return;
+
+   while (apu.dmc.timer <= cycles)
    {
-      apu.dmc.accum -= apu.cycle_rate;
+      cycle += apu.dmc.timer;
+      cycles -= apu.dmc.timer;
 
-      while (apu.dmc.accum < 0)
-      {
-         apu.dmc.accum += apu.dmc.freq;
+      apu.dmc.timer = apu.dmc.freq;
 
-         delta_bit = (apu.dmc.dma_length & 7) ^ 7;
+      delta_bit = (apu.dmc.dma_length & 7) ^ 7;
 
-         if (7 == delta_bit)
-         {
-            apu.dmc.cur_byte = mem_getbyte(apu.dmc.address);
+      if (7 == delta_bit)
+      {
+         apu.dmc.cur_byte = mem_getbyte(apu.dmc.address);
 
-            /* steal a cycle from CPU*/
-            nes6502_burn(1);
+         /* steal a cycle from CPU*/
+         nes6502_burn(1);
 
-            /* prevent wraparound */
-            if (0xFFFF == apu.dmc.address)
-               apu.dmc.address = 0x8000;
-            else
-               apu.dmc.address++;
-         }
+         /* prevent wraparound */
+         if (0xFFFF == apu.dmc.address)
+            apu.dmc.address = 0x8000;
+         else
+            apu.dmc.address++;
+      }
 
-         if (--apu.dmc.dma_length == 0)
+      if (--apu.dmc.dma_length == 0)
+      {
+         /* if loop bit set, we're cool to retrigger sample */
+         if (apu.dmc.looping)
          {
-            /* if loop bit set, we're cool to retrigger sample */
-            if (apu.dmc.looping)
-            {
-               apu_dmcreload();
-            }
-            else
+            apu_dmcreload();
+         }
+         else
+         {
+            /* check to see if we should generate an irq */
+            if (apu.dmc.irq_gen)
             {
-               /* check to see if we should generate an irq */
-               if (apu.dmc.irq_gen)
-               {
-                  apu.dmc.irq_occurred = true;
-                  nes6502_irq();
-               }
-
-               /* bodge for timestamp queue */
-               apu.dmc.enabled = false;
-               break;
+               apu.dmc.irq_occurred = true;
+               nes6502_irq();
             }
+
+            /* bodge for timestamp queue */
+            apu.dmc.enabled = false;
+            return;
          }
+      }
 
-         /* positive delta */
-         if (apu.dmc.cur_byte & (1 << delta_bit))
+      /* positive delta */
+      if (apu.dmc.cur_byte & (1 << delta_bit))
+      {
+         if (apu.dmc.regs[1] < 0x7D)
          {
-            if (apu.dmc.regs[1] < 0x7D)
-            {
-               apu.dmc.regs[1] += 2;
-               apu.dmc.output_vol += (2 << 8);
-            }
+            apu.dmc.regs[1] += 2;
+            apu_output(4, &apu.dmc.output_vol, apu.dmc.output_vol + (2 << 8), cycle);
          }
-         /* negative delta */
-         else
+      }
+      /* negative delta */
+      else
+      {
+         if (apu.dmc.regs[1] > 1)
          {
-            if (apu.dmc.regs[1] > 1)
-            {
-               apu.dmc.regs[1] -= 2;
-               apu.dmc.output_vol -= (2 << 8);
-            }
+            apu.dmc.regs[1] -= 2;
+            apu_output(4, &apu.dmc.output_vol, apu.dmc.output_vol - (2 << 8), cycle);
          }
       }
    }
 
-   return APU_DMC_OUTPUT;
+   apu.dmc.timer -= cycles;
+}
+
+/* Envelopes/linear counter at 240Hz, length counters and sweeps at 120Hz */
+static void apu_quarter_frame(uint32 cycle)
+{
+   apu_rectangle_quarter(&apu.rectangle[0]);
+   apu_rectangle_quarter(&apu.rectangle[1]);
+   apu_triangle_quarter();
+   apu_noise_quarter();
+
+   if (++blip.seq_step & 1)
+   {
+      apu_rectangle_half(0);
+      apu_rectangle_half(1);
+      apu_triangle_half();
+      apu_noise_half();
+   }
+
+   /* volume and silence changes */
+   apu_output(0, &apu.rectangle[0].output_vol, apu_rectangle_level(&apu.rectangle[0]), cycle);
+   apu_output(1, &apu.rectangle[1].output_vol, apu_rectangle_level(&apu.rectangle[1]), cycle);
+   apu_output(3, &apu.noise.output_vol, apu_noise_level(apu.noise.output_vol > 0), cycle);
+}
+
+/* Step all channels up to the given cpu cycle */
+static IRAM_ATTR void apu_run(uint32 target)
+{
+   int32 cycles = target - blip.cycles;
+
+   while (cycles > 0)
+   {
+      int32 step = (blip.seq_ticks + blip.ticks_per_cycle - 1) / blip.ticks_per_cycle;
+      uint32 cycle = blip.cycles;
+
+      if (step > cycles)
+         step = cycles;
+
+      apu_rectangle(0, cycle, step);
+      apu_rectangle(1, cycle, step);
+      apu_triangle(cycle, step);
+      apu_noise(cycle, step);
+      apu_dmc(cycle, step);
+
+      blip.cycles += step;
+      blip.seq_ticks -= step * blip.ticks_per_cycle;
+      cycles -= step;
+
+      if (blip.seq_ticks <= 0)
+      {
+         blip.seq_ticks += blip.quarter_ticks;
+         apu_quarter_frame(blip.cycles);
+      }
+   }
+}
+
+/* Outputs that registers writes can change directly */
+INLINE void apu_refresh_outputs(uint32 cycle)
+{
+   apu_output(0, &apu.rectangle[0].output_vol, apu_rectangle_level(&apu.rectangle[0]), cycle);
+   apu_output(1, &apu.rectangle[1].output_vol, apu_rectangle_level(&apu.rectangle[1]), cycle);
+
+   if (false == apu.noise.enabled || 0 == apu.noise.vbl_length)
+      apu_output(3, &apu.noise.output_vol, 0, cycle);
 }
 
 
@@ -630,6 +610,9 @@ IRAM_ATTR void apu_write(uint32 address, uint8 value)
 {
    int chan;
 
+   /* catch up with the cpu so that the change happens at the right time */
+   apu_run(nes6502_getcycles());
+
    switch (address)
    {
    /* rectangles */
@@ -698,11 +681,11 @@ IRAM_ATTR void apu_write(uint32 address, uint8 value)
       ** then to reg 0, and the counter accidentally starts running because
       ** of the sound queue's timestamp processing.
       **
-      ** set latency to a couple hundred cycles -- should be plenty of time
-      ** for the 6502 code to do a couple of table dereferences and load up
-      ** the other triregs
+      ** the counter starts on the next quarter frame clock, which leaves
+      ** plenty of time for the 6502 code to do a couple of table
+      ** dereferences and load up the other triregs
       */
-      apu.triangle.write_latency = (int) (228 / apu.cycle_rate);
+      apu.triangle.write_latency = 1;
       apu.triangle.freq = (((value & 7) << 8) + apu.triangle.regs[1]) + 1;
       apu.triangle.vbl_length = vbl_lut[value >> 3];
       apu.triangle.counter_started = false;
@@ -721,19 +704,7 @@ IRAM_ATTR void apu_write(uint32 address, uint8 value)
    case APU_WRD2:
       apu.noise.regs[1] = value;
       apu.noise.freq = noise_freq[value & 0x0F];
-
-#ifdef REALTIME_NOISE
       apu.noise.xor_tap = (value & 0x80) ? 0x40: 0x02;
-#else /* !REALTIME_NOISE */
-      /* detect transition from long->short sample */
-      if ((value & 0x80) && false == apu.noise.short_sample)
-      {
-         /* recalculate short noise buffer */
-         shift_register15(noise_short_lut, APU_NOISE_93);
-         apu.noise.cur_pos = 0;
-      }
-      apu.noise.short_sample = (value >> 7) & 1;
-#endif /* !REALTIME_NOISE */
       break;
 
    case APU_WRD3:
@@ -764,7 +735,7 @@ IRAM_ATTR void apu_write(uint32 address, uint8 value)
       ** current output level of the volume reg
       */
       value &= 0x7F; /* bit 7 ignored */
-      apu.dmc.output_vol += ((value - apu.dmc.regs[1]) << 8);
+      apu_output(4, &apu.dmc.output_vol, apu.dmc.output_vol + ((value - apu.dmc.regs[1]) << 8), blip.cycles);
       apu.dmc.regs[1] = value;
       break;
 
@@ -846,6 +817,8 @@ IRAM_ATTR void apu_write(uint32 address, uint8 value)
    default:
       break;
    }
+
+   apu_refresh_outputs(blip.cycles);
 }
 
 /* Read from $4000-$4017 */
@@ -856,6 +829,8 @@ IRAM_ATTR uint8 apu_read(uint32 address)
    switch (address)
    {
    case APU_SMASK:
+      apu_run(nes6502_getcycles());
+
       value = 0;
       /* Return 1 in 0-5 bit pos if a channel is playing */
       if (apu.rectangle[0].enabled && apu.rectangle[0].vbl_length)
@@ -889,68 +864,112 @@ IRAM_ATTR uint8 apu_read(uint32 address)
    return value;
 }
 
+/* Map frame_ticks to exactly num_samples output samples */
+static void apu_set_samples_per_frame(int num_samples)
+{
+   blip.num_samples = num_samples;
+   blip.factor = ((uint64_t)num_samples << 48) / blip.frame_ticks;
+   blip.max_ticks = ((uint64_t)BLIP_BUFFER_SIZE << 48) / blip.factor;
+}
+
+/* Forget everything buffered and restart the timeline at the current cpu cycle */
+static void apu_sync(void)
+{
+   memset(blip_buf, 0, sizeof(blip_buf));
+   blip.cycles = nes6502_getcycles();
+   blip.base_cycle = blip.cycles;
+   blip.base_frac = 0;
+   blip.used = 0;
+}
+
 IRAM_ATTR void apu_process(void *buffer, int num_samples)
 {
-   static int32 prev_sample = 0;
+   int16 *buf16 = (int16 *) buffer;
+   uint32 now = nes6502_getcycles();
+   uint32 frame_end, frame_cycles;
 
-   int16 *buf16;
+   if (num_samples > BLIP_BUFFER_SIZE / 2)
+      num_samples = BLIP_BUFFER_SIZE / 2;
 
-   if (NULL != buffer)
+   if (num_samples != blip.num_samples)
+      apu_set_samples_per_frame(num_samples);
+
+   /* we weren't called for a while (fast forward), drop what's buffered */
+   if (now - blip.base_cycle > 4 * blip.frame_ticks / blip.ticks_per_cycle)
    {
-      buf16 = (int16 *) buffer;
+      apu_run(now);
+      apu_sync();
+   }
 
-      while (num_samples--)
-      {
-         int32 next_sample, accum = 0;
-
-         if (OPT(APU_CHANNEL1_EN))
-            accum += apu_rectangle_0();
-         if (OPT(APU_CHANNEL2_EN))
-            accum += apu_rectangle_1();
-         if (OPT(APU_CHANNEL3_EN))
-            accum += apu_triangle();
-         if (OPT(APU_CHANNEL4_EN))
-            accum += apu_noise();
-         if (OPT(APU_CHANNEL5_EN))
-            accum += apu_dmc();
-         if (apu.ext && OPT(APU_CHANNEL6_EN))
-            accum += apu.ext->process();
-
-         /* do any filtering */
-         if (APU_FILTER_NONE != OPT(APU_FILTER_TYPE))
-         {
-            next_sample = accum;
+   /* run to the cpu, or slightly past it when this frame was a few cycles short */
+   frame_cycles = (blip.frame_ticks + blip.base_frac + blip.ticks_per_cycle - 1) / blip.ticks_per_cycle;
+   frame_end = blip.base_cycle + frame_cycles;
 
-            if (APU_FILTER_LOWPASS == OPT(APU_FILTER_TYPE))
-            {
-               accum += prev_sample;
-               accum >>= 1;
-            }
-            else
-               accum = (accum + accum + accum + prev_sample) >> 2;
+   apu_run(((int32)(frame_end - now) > 0) ? frame_end : now);
+
+   for (int i = 0; i < num_samples; i++)
+   {
+      int32 next_sample, accum;
+
+      blip.level += blip_buf[i];
+      blip.level -= blip.level >> 7; /* volume decay */
+
+      accum = blip.level >> BLIP_KERNEL_BITS;
+
+      if (apu.ext && OPT(APU_CHANNEL6_EN))
+         accum += apu.ext->process();
 
-            prev_sample = next_sample;
+      /* do any filtering */
+      if (APU_FILTER_NONE != OPT(APU_FILTER_TYPE))
+      {
+         next_sample = accum;
+
+         if (APU_FILTER_LOWPASS == OPT(APU_FILTER_TYPE))
+         {
+            accum += blip.prev_sample;
+            accum >>= 1;
          }
+         else
+            accum = (accum + accum + accum + blip.prev_sample) >> 2;
 
-         /* do clipping */
-         if (accum > 0x7FFF)
-            accum = 0x7FFF;
-         else if (accum < -0x8000)
-            accum = -0x8000;
+         blip.prev_sample = next_sample;
+      }
+
+      /* do clipping */
+      if (accum > 0x7FFF)
+         accum = 0x7FFF;
+      else if (accum < -0x8000)
+         accum = -0x8000;
 
-         /* signed 16-bit output */
+      /* signed 16-bit output */
+      if (buf16)
          *buf16++ = (int16) accum;
+   }
 
-         // Advance frame counter
-         // apu_fc_advance(apu.cycle_rate);
-      }
+   /* move what belongs to the next frame to the front */
+   if (blip.used > num_samples)
+   {
+      memmove(blip_buf, blip_buf + num_samples, (blip.used - num_samples) * sizeof(int32));
+      memset(blip_buf + blip.used - num_samples, 0, num_samples * sizeof(int32));
+      blip.used -= num_samples;
    }
+   else
+   {
+      memset(blip_buf, 0, blip.used * sizeof(int32));
+      blip.used = 0;
+   }
+
+   blip.base_frac += blip.frame_ticks;
+   blip.base_cycle += blip.base_frac / blip.ticks_per_cycle;
+   blip.base_frac %= blip.ticks_per_cycle;
 }
 
 void apu_reset(void)
 {
    uint32 address;
 
+   apu_sync();
+
    /* initialize all channel members */
    for (address = 0x4000; address <= 0x4013; address++)
       apu_write(address, 0);
@@ -962,27 +981,47 @@ void apu_reset(void)
       apu.ext->reset();
 }
 
-void apu_build_luts(int num_samples)
+static void apu_build_luts(void)
 {
    int i;
 
-   /* lut used for enveloping and frequency sweeps */
+   /* lut used for enveloping and frequency sweeps, in quarter/half frame clocks */
    for (i = 0; i < 16; i++)
-      decay_lut[i] = num_samples * (i + 1);
+      decay_lut[i] = i + 1;
 
-   /* used for note length, based on vblanks and size of audio buffer */
+   /* used for note length, in half frame clocks */
    for (i = 0; i < 32; i++)
-      vbl_lut[i] = vbl_length[i] * num_samples;
+      vbl_lut[i] = vbl_length[i] * 2;
 
-   /* triangle wave channel's linear length table */
+   /* triangle wave channel's linear length table, in quarter frame clocks */
    for (i = 0; i < 128; i++)
-      trilength_lut[i] = (int) (0.25 * i * num_samples);
+      trilength_lut[i] = i;
+
+   /* windowed sinc, integrates to 1 << BLIP_KERNEL_BITS for every phase */
+   for (int phase = 0; phase < BLIP_PHASES; phase++)
+   {
+      float taps[BLIP_WIDTH], sum = 0;
+      int32 total = 0, center = BLIP_WIDTH / 2 - 1;
+
+      for (i = 0; i < BLIP_WIDTH; i++)
+      {
+         float x = i - center - (float) phase / BLIP_PHASES;
+         float w = 0.42f + 0.5f * cosf(2 * M_PI * x / BLIP_WIDTH) + 0.08f * cosf(4 * M_PI * x / BLIP_WIDTH);
+         float t = M_PI * 0.9f * x;
 
-#ifndef REALTIME_NOISE
-   /* generate noise samples */
-   shift_register15(noise_long_lut, APU_NOISE_32K);
-   shift_register15(noise_short_lut, APU_NOISE_93);
-#endif /* !REALTIME_NOISE */
+         taps[i] = w * ((x == 0) ? 1.f : sinf(t) / t);
+         sum += taps[i];
+      }
+
+      for (i = 0; i < BLIP_WIDTH; i++)
+      {
+         blip_kernel[phase][i] = (int16) (taps[i] / sum * (1 << BLIP_KERNEL_BITS) + 0.5f);
+         total += blip_kernel[phase][i];
+      }
+
+      /* put the rounding error on the largest tap */
+      blip_kernel[phase][(phase < BLIP_PHASES / 2) ? center : center + 1] += (1 << BLIP_KERNEL_BITS) - total;
+   }
 }
 
 void apu_setopt(apu_option_t n, int val)
@@ -1006,23 +1045,28 @@ int apu_getopt(apu_option_t n)
 apu_t *apu_init(int region, int sample_rate)
 {
    memset(&apu, 0, sizeof(apu_t));
+   memset(&blip, 0, sizeof(blip));
 
    short refresh_rate;
-   float cpu_clock;
 
+   /* 4 ticks per quarter frame keep both the frame and quarter frame integers */
    if (region == NES_PAL)
    {
       refresh_rate = NES_REFRESH_RATE_PAL;
-      cpu_clock = NES_CPU_CLOCK_PAL;
+      blip.ticks_per_cycle = 8; /* 341 * 5 / 16 cycles per line */
+      blip.frame_ticks = NES_SCANLINES_PAL * 341 * 5 / 2;
    }
    else
    {
       refresh_rate = NES_REFRESH_RATE_NTSC;
-      cpu_clock = NES_CPU_CLOCK_NTSC;
+      blip.ticks_per_cycle = 12; /* 341 / 3 cycles per line */
+      blip.frame_ticks = NES_SCANLINES_NTSC * 341 * 4;
    }
 
+   blip.quarter_ticks = blip.frame_ticks / 4;
+   blip.seq_ticks = blip.quarter_ticks;
+
    apu.sample_rate = sample_rate;
-   apu.cycle_rate = (float) (cpu_clock / sample_rate);
    apu.ext = NULL;
 
    apu_setopt(APU_FILTER_TYPE, APU_FILTER_WEIGHTED);
@@ -1033,7 +1077,9 @@ apu_t *apu_init(int region, int sample_rate)
    apu_setopt(APU_CHANNEL5_EN, true);
    apu_setopt(APU_CHANNEL6_EN, true);
 
-   apu_build_luts(sample_rate / refresh_rate);
+   apu_build_luts();
+   apu_set_samples_per_frame(sample_rate / refresh_rate);
+   apu_sync();
 
    return &apu;
 }
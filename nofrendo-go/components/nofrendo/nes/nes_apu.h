@@ -27,9 +27,6 @@
 #define _NES_APU_H_
 
 
-/* define this for realtime generated noise */
-#define  REALTIME_NOISE
-
 #define  APU_WRA0       0x4000
 #define  APU_WRA1       0x4001
 #define  APU_WRA2       0x4002
@@ -52,14 +49,10 @@
 #define  APU_SMASK      0x4015
 #define  APU_FRAME_IRQ  0x4017
 
-/* length of generated noise */
-#define  APU_NOISE_32K  0x7FFF
-#define  APU_NOISE_93   93
-
-
 /* channel structures */
 /* As much data as possible is precalculated,
-** to keep the sample processing as lean as possible
+** to keep the cycle stepping as lean as possible.
+** timer is the number of cpu cycles left before the next step.
 */
 
 typedef struct rectangle_s
@@ -68,7 +61,7 @@ typedef struct rectangle_s
 
    bool enabled;
 
-   float accum;
+   int32 timer;
    int32 freq;
    int32 output_vol;
    bool fixed_envelope;
@@ -99,7 +92,7 @@ typedef struct triangle_s
 
    bool enabled;
 
-   float accum;
+   int32 timer;
    int32 freq;
    int32 output_vol;
 
@@ -121,7 +114,7 @@ typedef struct noise_s
 
    bool enabled;
 
-   float accum;
+   int32 timer;
    int32 freq;
    int32 output_vol;
 
@@ -135,12 +128,7 @@ typedef struct noise_s
 
    int vbl_length;
 
-#ifdef REALTIME_NOISE
    uint8 xor_tap;
-#else
-   bool short_sample;
-   int cur_pos;
-#endif /* REALTIME_NOISE */
 } noise_t;
 
 typedef struct dmc_s
@@ -150,7 +138,7 @@ typedef struct dmc_s
    /* bodge for timestamp queue */
    bool enabled;
 
-   float accum;
+   int32 timer;
    int32 freq;
    int32 output_vol;
 
@@ -201,7 +189,6 @@ typedef struct apu_s
    dmc_t dmc;
    uint8 control_reg;
 
-   float cycle_rate;
    int sample_rate;
 
    struct {
@@ -102,17 +102,45 @@ void mem_refresh()
                sizeof(mem_write_handler_t));
    }
 
-   // Mark pages if they contain handlers (used for fast access in nes6502)
-   for (mem_read_handler_t *mr = mem.read_handlers; mr->read_func != NULL; mr++)
-   {
-      for (int i = mr->min_range; i < mr->max_range; i++)
-         mem.pages_read[i >> MEM_PAGESHIFT] = MEM_PAGE_USE_HANDLERS;
-   }
+   memset(&mem.read_map, 0, sizeof(mem.read_map));
+   memset(&mem.write_map, 0, sizeof(mem.write_map));
 
-   for (mem_write_handler_t *mw = mem.write_handlers; mw->write_func != NULL; mw++)
+   // Index the handlers by page and mark those pages (used for fast access in nes6502)
+   for (int page = 0; page < MEM_PAGECOUNT; page++)
    {
-      for (int i = mw->min_range; i < mw->max_range; i++)
-         mem.pages_write[i >> MEM_PAGESHIFT] = MEM_PAGE_USE_HANDLERS;
+      uint32 page_min = page * MEM_PAGESIZE;
+      uint32 page_max = page_min + MEM_PAGEMASK;
+      int count = 0;
+
+      for (mem_read_handler_t *mr = mem.read_handlers; mr->read_func != NULL; mr++)
+      {
+         if (mr->min_range <= page_max && mr->max_range >= page_min)
+         {
+            if (count == MEM_PAGE_HANDLERS)
+            {
+               MESSAGE_ERROR("Too many read handlers on page %d\n", page);
+               break;
+            }
+            mem.read_map[page][count++] = mr;
+            mem.pages_read[page] = MEM_PAGE_USE_HANDLERS;
+         }
+      }
+
+      count = 0;
+
+      for (mem_write_handler_t *mw = mem.write_handlers; mw->write_func != NULL; mw++)
+      {
+         if (mw->min_range <= page_max && mw->max_range >= page_min)
+         {
+            if (count == MEM_PAGE_HANDLERS)
+            {
+               MESSAGE_ERROR("Too many write handlers on page %d\n", page);
+               break;
+            }
+            mem.write_map[page][count++] = mw;
+            mem.pages_write[page] = MEM_PAGE_USE_HANDLERS;
+         }
+      }
    }
 
    ASSERT(num_read_handlers <= MEM_HANDLERS_MAX);
@@ -156,10 +184,15 @@ IRAM_ATTR uint8 mem_getbyte(uint32 address)
    /* Special memory handlers */
    if (MEM_PAGE_HAS_HANDLERS(page))
    {
-      for (mem_read_handler_t *mr = mem.read_handlers; mr->read_func != NULL; mr++)
+      for (mem_read_handler_t **mr = mem.read_map[address >> MEM_PAGESHIFT]; *mr != NULL; mr++)
       {
-         if (address >= mr->min_range && address <= mr->max_range)
-            return mr->read_func(address);
+         if (address >= (*mr)->min_range && address <= (*mr)->max_range)
+         {
+#ifdef NOFRENDO_DEBUG
+            mem.dispatches++;
+#endif
+            return (*mr)->read_func(address);
+         }
       }
       page = mem.pages[address >> MEM_PAGESHIFT];
    }
@@ -185,11 +218,14 @@ IRAM_ATTR void mem_putbyte(uint32 address, uint8 value)
    /* Special memory handlers */
    if (MEM_PAGE_HAS_HANDLERS(page))
    {
-      for (mem_write_handler_t *mw = mem.write_handlers; mw->write_func != NULL; mw++)
+      for (mem_write_handler_t **mw = mem.write_map[address >> MEM_PAGESHIFT]; *mw != NULL; mw++)
       {
-         if (address >= mw->min_range && address <= mw->max_range)
+         if (address >= (*mw)->min_range && address <= (*mw)->max_range)
          {
-            mw->write_func(address, value);
+#ifdef NOFRENDO_DEBUG
+            mem.dispatches++;
+#endif
+            (*mw)->write_func(address, value);
             return;
          }
       }
@@ -45,6 +45,7 @@
 #define MEM_PAGE_IS_VALID_PTR(page) ((page) > ((uint8*)100))
 
 #define MEM_HANDLERS_MAX     32
+#define MEM_PAGE_HANDLERS    8
 
 #define LAST_MEMORY_HANDLER  { -1, -1, NULL }
 
@@ -76,6 +77,13 @@ typedef struct
    mem_read_handler_t read_handlers[MEM_HANDLERS_MAX];
    mem_write_handler_t write_handlers[MEM_HANDLERS_MAX];
 
+   /* Handlers overlapping each page, in priority order, NULL terminated */
+   mem_read_handler_t *read_map[MEM_PAGECOUNT][MEM_PAGE_HANDLERS + 1];
+   mem_write_handler_t *write_map[MEM_PAGECOUNT][MEM_PAGE_HANDLERS + 1];
+
+   /* Handler calls, for profiling (NOFRENDO_DEBUG only) */
+   uint32 dispatches;
+
    mapintf_t *mapper;
 } mem_t;
 
@@ -29,6 +29,7 @@
 #include "nes_ppu.h"
 #include "nes_mmc.h"
 #include "nes_rom.h"
+#include <osd.h>
 
 #define  MMC_8KPRG         (mmc.prg_banks * 2)
 #define  MMC_16KPRG        (mmc.prg_banks)
@@ -38,8 +39,135 @@
 #define  MMC_2KCHR         (mmc.chr_banks * 4)
 #define  MMC_1KCHR         (mmc.chr_banks * 8)
 
+/* Budget of the caches used when the ROM banks are read on demand */
+#define  MMC_PRG_CACHE_SIZE   0x40000
+#define  MMC_CHR_CACHE_SIZE   0x20000
+
+typedef struct bank_cache_s
+{
+   uint8 *data;
+   int16 *slots;     /* bank -> slot, -1 if not loaded */
+   int16 *banks;     /* slot -> bank, -1 if free */
+   uint32 *stamps;   /* slot -> last use */
+   int16 windows[12];/* window -> slot, those can't be evicted */
+   int slot_count;
+   int bank_count;
+   int bank_size;
+   size_t offset;
+   uint32 clock;
+   uint32 hits, misses;
+} bank_cache_t;
+
 static mmc_t mmc;
+static bank_cache_t prg_cache;
+static bank_cache_t chr_cache;
+
+
+static void cache_free(bank_cache_t *cache)
+{
+   free(cache->data);
+   free(cache->slots);
+   free(cache->banks);
+   free(cache->stamps);
+   memset(cache, 0, sizeof(bank_cache_t));
+}
+
+static bool cache_init(bank_cache_t *cache, int bank_count, int bank_size, size_t offset, size_t budget)
+{
+   memset(cache, 0, sizeof(bank_cache_t));
+
+   cache->bank_count = bank_count;
+   cache->bank_size = bank_size;
+   cache->offset = offset;
+   cache->slot_count = MIN(bank_count, (int)(budget / bank_size));
 
+   cache->data = malloc(cache->slot_count * bank_size);
+   cache->slots = malloc(bank_count * sizeof(int16));
+   cache->banks = malloc(cache->slot_count * sizeof(int16));
+   cache->stamps = calloc(cache->slot_count, sizeof(uint32));
+
+   if (!cache->data || !cache->slots || !cache->banks || !cache->stamps)
+   {
+      cache_free(cache);
+      return false;
+   }
+
+   memset(cache->slots, 0xFF, bank_count * sizeof(int16));
+   memset(cache->banks, 0xFF, cache->slot_count * sizeof(int16));
+   memset(cache->windows, 0xFF, sizeof(cache->windows));
+
+   return true;
+}
+
+/* Get a bank from the cache, reading it from the ROM file on a miss */
+static uint8 *cache_map(bank_cache_t *cache, int window, int bank)
+{
+   int slot = cache->slots[bank];
+
+   /* The bank being switched out stays mapped until the new one is loaded,
+   ** so its slot is never reused under the same PPU page pointer (which
+   ** would keep stale decoded tiles around).
+   */
+   if (slot >= 0)
+   {
+      cache->hits++;
+   }
+   else
+   {
+      uint32 oldest = UINT32_MAX;
+
+      /* Evict the least recently used bank that isn't mapped */
+      for (int i = 0; i < cache->slot_count; i++)
+      {
+         if (cache->banks[i] < 0)
+         {
+            slot = i;
+            break;
+         }
+
+         if (cache->stamps[i] < oldest)
+         {
+            bool mapped = false;
+
+            for (int w = 0; w < 12; w++)
+               mapped |= (cache->windows[w] == i);
+
+            if (!mapped)
+            {
+               oldest = cache->stamps[i];
+               slot = i;
+            }
+         }
+      }
+
+      if (slot < 0)
+      {
+         MESSAGE_ERROR("MMC: No free slot for bank %d!\n", bank);
+         abort();
+      }
+
+      if (cache->banks[slot] >= 0)
+         cache->slots[cache->banks[slot]] = -1;
+
+      if (!osd_readromdata(cache->data + slot * cache->bank_size,
+            cache->offset + bank * cache->bank_size, cache->bank_size))
+      {
+         MESSAGE_ERROR("MMC: Failed to read bank %d from ROM!\n", bank);
+         abort();
+      }
+
+      cache->banks[slot] = bank;
+      cache->slots[bank] = slot;
+      cache->misses++;
+   }
+
+   if (window >= 0)
+      cache->windows[window] = slot;
+
+   cache->stamps[slot] = ++cache->clock;
+
+   return cache->data + slot * cache->bank_size;
+}
 
 rominfo_t *mmc_getinfo(void)
 {
@@ -98,7 +226,33 @@ void mmc_bankptr(int size, uint32 address, int bank, uint8 *ptr)
 /* PRG-ROM bankswitching */
 void mmc_bankrom(int size, uint32 address, int bank)
 {
-   mmc_bankptr(size, address, bank, mmc.prg);
+   int units = size / 8;
+   int count = MMC_8KPRG / units;
+
+   if (size != 8 && size != 16 && size != 32)
+   {
+      MESSAGE_ERROR("MMC: Invalid bank size! Addr: $%04X Bank: %d Size: %d\n", address, bank, size);
+      abort();
+   }
+
+   bank = (bank >= 0 ? bank : count + bank) % count;
+
+   for (int i = 0; i < units; i++)
+   {
+      int window = ((address >> 13) + i) & 7;
+      int unit = bank * units + i;
+      uint8 *base;
+
+      if (mmc.prg)
+         base = mmc.prg + (unit << 13);
+      else
+         base = cache_map(&prg_cache, window, unit);
+
+      for (int j = 0; j < 0x2000 / MEM_PAGESIZE; j++)
+         mem_setpage((window << 13 >> MEM_PAGESHIFT) + j, base + j * MEM_PAGESIZE);
+
+      mmc.prg_map[window] = unit;
+   }
 }
 
 /* PRG-RAM bankswitching */
@@ -110,34 +264,68 @@ void mmc_bankwram(int size, uint32 address, int bank)
 /* CHR-ROM bankswitching */
 void mmc_bankvrom(int size, uint32 address, int bank)
 {
-   switch (size)
+   int page = (address >> 10) & 7;
+   int count = MMC_1KCHR / size;
+
+   if (size != 1 && size != 2 && size != 4 && size != 8)
    {
-   case 1:
-      bank = (bank >= 0 ? bank : MMC_1KCHR + bank) % MMC_1KCHR;
-      ppu_setpage(1, address >> 10, &mmc.chr[bank << 10] - address);
-      break;
+      MESSAGE_ERROR("MMC: Invalid CHR bank size %d\n", size);
+      abort();
+   }
 
-   case 2:
-      bank = (bank >= 0 ? bank : MMC_2KCHR + bank) % MMC_2KCHR;
-      ppu_setpage(2, address >> 10, &mmc.chr[bank << 11] - address);
-      break;
+   bank = (bank >= 0 ? bank : count + bank) % count;
 
-   case 4:
-      bank = (bank >= 0 ? bank : MMC_4KCHR + bank) % MMC_4KCHR;
-      ppu_setpage(4, address >> 10, &mmc.chr[bank << 12] - address);
-      break;
+   for (int i = 0; i < size; i++)
+      mmc.chr_map[page + i] = bank * size + i;
 
-   case 8:
-      bank = (bank >= 0 ? bank : MMC_8KCHR + bank) % MMC_8KCHR;
-      ppu_setpage(8, 0, &mmc.chr[bank << 13]);
-      break;
-
-   default:
-      MESSAGE_ERROR("MMC: Invalid CHR bank size %d\n", size);
-      abort();
+   if (mmc.chr)
+   {
+      ppu_setpage(size, page, &mmc.chr[(bank * size) << 10] - (page << 10));
+   }
+   else
+   {
+      /* the cached 1K banks aren't contiguous */
+      for (int i = 0; i < size; i++)
+         ppu_setpage(1, page + i, cache_map(&chr_cache, page + i, bank * size + i) - ((page + i) << 10));
    }
 }
 
+/* Get a 1K CHR-ROM bank to map it somewhere else than the pattern tables */
+uint8 *mmc_getvrom(int page, int bank)
+{
+   bank = (bank >= 0 ? bank : MMC_1KCHR + bank) % MMC_1KCHR;
+
+   if (page < 12)
+      mmc.chr_map[page] = bank;
+
+   if (mmc.chr)
+      return &mmc.chr[bank << 10];
+   else
+      return cache_map(&chr_cache, page < 12 ? page : -1, bank);
+}
+
+/* Read a byte of CHR-ROM/RAM outside of the PPU pages */
+uint8 mmc_getchrbyte(uint32 offset)
+{
+   if (mmc.chr)
+      return mmc.chr[offset];
+   else
+      return cache_map(&chr_cache, -1, (offset >> 10) % MMC_1KCHR)[offset & 0x3FF];
+}
+
+/* Report the bank cache hit rates since the last call */
+void mmc_cachestats(void)
+{
+   if (prg_cache.misses + chr_cache.misses == 0)
+      return;
+
+   MESSAGE_DEBUG("MMC: Bank cache PRG %d hits/%d misses, CHR %d hits/%d misses\n",
+                prg_cache.hits, prg_cache.misses, chr_cache.hits, chr_cache.misses);
+
+   prg_cache.hits = prg_cache.misses = 0;
+   chr_cache.hits = chr_cache.misses = 0;
+}
+
 /* Check to see if this mapper is supported */
 mapintf_t *mmc_peek(int map_num)
 {
@@ -190,7 +378,8 @@ void mmc_reset(void)
 
 void mmc_shutdown()
 {
-
+   cache_free(&prg_cache);
+   cache_free(&chr_cache);
 }
 
 mmc_t *mmc_init(rominfo_t *rominfo)
@@ -208,6 +397,21 @@ mmc_t *mmc_init(rominfo_t *rominfo)
    mmc.prg = rominfo->rom;
    mmc.prg_banks = rominfo->rom_banks;
 
+   if (rominfo->flags & ROM_FLAG_PAGED)
+   {
+      if (!cache_init(&prg_cache, rominfo->rom_banks * 2, 0x2000, rominfo->rom_offset, MMC_PRG_CACHE_SIZE)
+         || (rominfo->vrom_banks && !cache_init(&chr_cache, rominfo->vrom_banks * 8, 0x400,
+                                                rominfo->vrom_offset, MMC_CHR_CACHE_SIZE)))
+      {
+         MESSAGE_ERROR("MMC: Could not allocate the bank cache\n");
+         mmc_shutdown();
+         return NULL;
+      }
+
+      MESSAGE_INFO("MMC: Paging ROM banks from file (%d PRG, %d CHR slots)\n",
+                   prg_cache.slot_count, chr_cache.slot_count);
+   }
+
    if (rominfo->vrom_banks)
    {
       mmc.chr = rominfo->vrom;
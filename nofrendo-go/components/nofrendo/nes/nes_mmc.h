@@ -55,6 +55,8 @@ struct mmc_s
    rominfo_t *cart;  /* link it back to the cart */
    uint8 *prg, *chr;
    uint8 prg_banks, chr_banks;
+   uint16 prg_map[8];   /* 8K PRG bank in each CPU window */
+   uint16 chr_map[12];  /* 1K CHR bank in each PPU page */
 };
 
 #define MMC_LASTBANK      -1
@@ -62,6 +64,9 @@ struct mmc_s
 extern void mmc_bankwram(int size, uint32 address, int bank);
 extern void mmc_bankvrom(int size, uint32 address, int bank);
 extern void mmc_bankrom(int size, uint32 address, int bank);
+extern uint8 *mmc_getvrom(int page, int bank);
+extern uint8 mmc_getchrbyte(uint32 offset);
+extern void mmc_cachestats(void);
 
 extern mmc_t *mmc_init(rominfo_t *rominfo);
 extern void mmc_refresh(void);
@@ -56,6 +56,25 @@
 /* the NES PPU */
 static ppu_t ppu;
 
+/* Decoded pattern cache
+** Each 1K pattern page is decoded on demand, one uint16 per tile row with
+** 2 bits per pixel and the leftmost pixel in the top bits. Tiles are dropped
+** when their page is remapped by ppu_setpage() or when CHR RAM is written.
+*/
+static uint16 tile_cache[8][64 * 8];
+static uint8 tile_opaque[8][64 * 8];
+static uint64_t tile_cache_valid[8];
+
+/* Spreads the 8 bits of a pattern plane to every other bit */
+static uint16 tile_spread[256];
+
+/* Background palettes expanded to 4 pixels per lookup, one per attribute */
+static uint32 bg_lut[4][256];
+static uint8 bg_lut_dirty = 0x0F;
+
+/* Scratch line for fine x scrolled backgrounds, so tiles stay word aligned */
+static uint32 bg_line[(NES_SCREEN_WIDTH + 16) / 4];
+
 rgb_t gui_pal[] =
 {
    { 0x00, 0x00, 0x00 }, /* black      */
@@ -79,10 +98,31 @@ INLINE uint8 PPU_MEM_READ(uint32 x)
 }
 #endif
 
+/* Drop all the decoded tiles and palettes */
+void ppu_refresh(void)
+{
+   memset(tile_cache_valid, 0, sizeof(tile_cache_valid));
+   bg_lut_dirty = 0x0F;
+}
+
+/* A CHR RAM byte changed, drop that tile from every page mapping it */
+INLINE void ppu_invalidate_tile(uint32 address)
+{
+   uint8 *location = &ppu.page[address >> 10][address];
+   uint32 offset = address & 0x3FF;
+
+   for (int i = 0; i < 8; i++)
+   {
+      if (&ppu.page[i][(i << 10) | offset] == location)
+         tile_cache_valid[i] &= ~(1ULL << (offset >> 4));
+   }
+}
+
 void ppu_setcontext(ppu_t *src_ppu)
 {
    ASSERT(src_ppu);
    ppu = *src_ppu;
+   ppu_refresh();
 
    // Translate the source name table addresses to local pointers
    ppu.page[8]  = ppu.nametab + ((src_ppu->page[8] - src_ppu->nametab) & ~0x3FF);
@@ -108,6 +148,13 @@ void ppu_getcontext(ppu_t *dest_ppu)
 
 void ppu_setpage(int size, int page_num, uint8 *location)
 {
+   /* drop the decoded tiles of the pattern pages that change */
+   for (int i = page_num; i < page_num + size && i < 8; i++)
+   {
+      if (ppu.page[i] != location)
+         tile_cache_valid[i] = 0;
+   }
+
    /* deliberately fall through */
    switch (size)
    {
@@ -171,6 +218,8 @@ void ppu_reset()
 
    ppu.latch = 0;
    ppu.vram_accessible = true;
+
+   ppu_refresh();
 }
 
 INLINE void ppu_oamdma(uint8 value)
@@ -363,6 +412,9 @@ IRAM_ATTR void ppu_write(uint32 address, uint8 value)
             MESSAGE_DEBUG("VRAM write to $%04X, scanline %d\n",
                            ppu.vaddr, nes_getptr()->scanline);
             PPU_MEM_WRITE(ppu.vaddr, 0xFF); /* corrupt */
+
+            if (ppu.vaddr < 0x2000)
+               ppu_invalidate_tile(ppu.vaddr);
          }
          else
          {
@@ -372,6 +424,9 @@ IRAM_ATTR void ppu_write(uint32 address, uint8 value)
                ppu.vaddr -= 0x1000;
 
             PPU_MEM_WRITE(addr, value);
+
+            if (addr < 0x2000)
+               ppu_invalidate_tile(addr);
          }
       }
       else
@@ -382,10 +437,15 @@ IRAM_ATTR void ppu_write(uint32 address, uint8 value)
 
             for (i = 0; i < 8; i ++)
                ppu.palette[i << 2] = (value & 0x3F) | BG_TRANS;
+
+            bg_lut_dirty = 0x0F;
          }
          else if (ppu.vaddr & 3)
          {
             ppu.palette[ppu.vaddr & 0x1F] = value & 0x3F;
+
+            if (0 == (ppu.vaddr & 0x10))
+               bg_lut_dirty |= 1 << ((ppu.vaddr >> 2) & 3);
          }
       }
 
@@ -461,12 +521,68 @@ void ppu_setvreadfunc(ppu_vreadfunc_t func)
 }
 
 /* rendering routines */
+static void ppu_decode_tile(int page, int tile)
+{
+   uint32 tile_addr = (page << 10) | (tile << 4);
+   uint16 *rows = &tile_cache[page][tile << 3];
+   uint8 *opaque = &tile_opaque[page][tile << 3];
+
+   for (int i = 0; i < 8; i++)
+   {
+      uint8 pat1 = PPU_MEM_READ(tile_addr + i);
+      uint8 pat2 = PPU_MEM_READ(tile_addr + i + 8);
+      rows[i] = (tile_spread[pat2] << 1) | tile_spread[pat1];
+      opaque[i] = pat1 | pat2;
+   }
+
+   tile_cache_valid[page] |= 1ULL << tile;
+}
+
 INLINE uint16 get_patpix(uint16 tile_addr)
 {
-   uint8 pat1 = PPU_MEM_READ(tile_addr);
-   uint8 pat2 = PPU_MEM_READ(tile_addr + 8);
-   return ((pat2 & 0xAA) << 8) | ((pat2 & 0x55) << 1)
-        | ((pat1 & 0xAA) << 7) | (pat1 & 0x55);
+   int page = tile_addr >> 10;
+   int tile = (tile_addr >> 4) & 0x3F;
+
+   if (!(tile_cache_valid[page] & (1ULL << tile)))
+      ppu_decode_tile(page, tile);
+
+   return tile_cache[page][(tile << 3) | (tile_addr & 7)];
+}
+
+/* Non-transparent pixels of a tile row, leftmost pixel in bit 7 */
+INLINE uint8 get_opaque(uint16 tile_addr)
+{
+   int page = tile_addr >> 10;
+   int tile = (tile_addr >> 4) & 0x3F;
+
+   if (!(tile_cache_valid[page] & (1ULL << tile)))
+      ppu_decode_tile(page, tile);
+
+   return tile_opaque[page][(tile << 3) | (tile_addr & 7)];
+}
+
+static void ppu_build_bg_lut(void)
+{
+   for (int pal = 0; pal < 4; pal++)
+   {
+      const uint8 *colors = ppu.palette + (pal << 2);
+
+      if (!(bg_lut_dirty & (1 << pal)))
+         continue;
+
+      for (int i = 0; i < 256; i++)
+      {
+#ifdef IS_LITTLE_ENDIAN
+         bg_lut[pal][i] = colors[(i >> 6) & 3] | (colors[(i >> 4) & 3] << 8)
+                        | (colors[(i >> 2) & 3] << 16) | (colors[i & 3] << 24);
+#else
+         bg_lut[pal][i] = (colors[(i >> 6) & 3] << 24) | (colors[(i >> 4) & 3] << 16)
+                        | (colors[(i >> 2) & 3] << 8) | colors[i & 3];
+#endif
+      }
+   }
+
+   bg_lut_dirty = 0;
 }
 
 INLINE void build_tile_colors(bool flip, uint16 pattern, uint8 *colors)
@@ -475,34 +591,50 @@ INLINE void build_tile_colors(bool flip, uint16 pattern, uint8 *colors)
    if (flip)
    {
       colors[7] = (pattern >> 14) & 3;
-      colors[6] = (pattern >> 6) & 3;
-      colors[5] = (pattern >> 12) & 3;
-      colors[4] = (pattern >> 4) & 3;
-      colors[3] = (pattern >> 10) & 3;
-      colors[2] = (pattern >> 2) & 3;
-      colors[1] = (pattern >> 8) & 3;
+      colors[6] = (pattern >> 12) & 3;
+      colors[5] = (pattern >> 10) & 3;
+      colors[4] = (pattern >> 8) & 3;
+      colors[3] = (pattern >> 6) & 3;
+      colors[2] = (pattern >> 4) & 3;
+      colors[1] = (pattern >> 2) & 3;
       colors[0] = pattern & 3;
    }
    else
    {
       colors[0] = (pattern >> 14) & 3;
-      colors[1] = (pattern >> 6) & 3;
-      colors[2] = (pattern >> 12) & 3;
-      colors[3] = (pattern >> 4) & 3;
-      colors[4] = (pattern >> 10) & 3;
-      colors[5] = (pattern >> 2) & 3;
-      colors[6] = (pattern >> 8) & 3;
+      colors[1] = (pattern >> 12) & 3;
+      colors[2] = (pattern >> 10) & 3;
+      colors[3] = (pattern >> 8) & 3;
+      colors[4] = (pattern >> 6) & 3;
+      colors[5] = (pattern >> 4) & 3;
+      colors[6] = (pattern >> 2) & 3;
       colors[7] = pattern & 3;
    }
 }
 
+/* Pixels of a sprite at x_loc that can trigger a sprite 0 strike, bit 7 is
+** the leftmost. Nothing in the blanked left hand column, nor at x=255.
+*/
+INLINE uint8 strike_mask(int x_loc)
+{
+   uint8 mask = 0xFF;
+
+   if (!ppu.left_bg_on && x_loc < 8)
+      mask &= 0xFF >> (8 - x_loc);
+   if (x_loc >= 248)
+      mask &= 0xFF << (x_loc - 247);
+
+   return mask;
+}
+
 /* we render a scanline of graphics first so we know exactly
 ** where the sprite 0 strike is going to occur (in terms of
 ** cpu cycles), using the relation that 3 pixels == 1 cpu cycle
 */
-INLINE void check_strike(uint8 *surface, uint8 attrib, uint16 pattern)
+INLINE void check_strike(uint8 *surface, int x_loc, uint8 attrib, uint16 pattern)
 {
    uint8 colors[8];
+   uint8 mask;
 
    /* Flag already set */
    if (ppu.strikeflag)
@@ -513,10 +645,12 @@ INLINE void check_strike(uint8 *surface, uint8 attrib, uint16 pattern)
       return;
 
    build_tile_colors(attrib & OAMF_HFLIP, pattern, colors);
+   mask = strike_mask(x_loc);
 
    for (int i = 0; i < 8; i++)
    {
-      if (colors[i] && (!surface || BG_SOLID(surface[i])))
+      /* the mask also keeps us from reading past the right edge */
+      if ((mask & (0x80 >> i)) && colors[i] && (!surface || BG_SOLID(surface[i])))
       {
          /* 3 pixels per cpu cycle */
          ppu.strike_cycle = nes6502_getcycles() + (i / 3);
@@ -529,12 +663,12 @@ INLINE void check_strike(uint8 *surface, uint8 attrib, uint16 pattern)
 INLINE void draw_bgtile(uint8 *surface, uint16 pattern, const uint8 *colors)
 {
    *surface++ = colors[(pattern >> 14) & 3];
-   *surface++ = colors[(pattern >> 6) & 3];
    *surface++ = colors[(pattern >> 12) & 3];
-   *surface++ = colors[(pattern >> 4) & 3];
    *surface++ = colors[(pattern >> 10) & 3];
-   *surface++ = colors[(pattern >> 2) & 3];
    *surface++ = colors[(pattern >> 8) & 3];
+   *surface++ = colors[(pattern >> 6) & 3];
+   *surface++ = colors[(pattern >> 4) & 3];
+   *surface++ = colors[(pattern >> 2) & 3];
    *surface   = colors[pattern & 3];
 }
 
@@ -575,7 +709,8 @@ INLINE void draw_oamtile(uint8 *surface, uint8 attrib, uint16 pattern, const uin
 
 INLINE void ppu_renderbg(uint8 *vidbuf)
 {
-   uint8 *bmp_ptr;
+   uint32 *bmp_ptr;
+   uint16 pattern;
    int32 refresh_vaddr, tile_addr, bg_offset, attrib_base, attrib_addr;
    uint8 tile_index, tile_num, x_tile, y_tile, col_high, attrib, attrib_shift;
 
@@ -586,7 +721,11 @@ INLINE void ppu_renderbg(uint8 *vidbuf)
       return;
    }
 
-   bmp_ptr = vidbuf - ppu.tile_xofs; /* scroll x */
+   if (bg_lut_dirty)
+      ppu_build_bg_lut();
+
+   /* scroll x, through the scratch line to keep the word stores aligned */
+   bmp_ptr = ppu.tile_xofs ? bg_line : (uint32 *) vidbuf;
    refresh_vaddr = 0x2000 + (ppu.vaddr & 0x0FE0); /* mask out x tile */
    x_tile = ppu.vaddr & 0x1F;
    y_tile = (ppu.vaddr >> 5) & 0x1F; /* to simplify calculations */
@@ -610,9 +749,11 @@ INLINE void ppu_renderbg(uint8 *vidbuf)
       if (ppu.latchfunc)
          ppu.latchfunc(ppu.bg_base, tile_index);
 
-      /* Fetch tile and draw it */
-      draw_bgtile(bmp_ptr, get_patpix(bg_offset + (tile_index << 4)), ppu.palette + col_high);
-      bmp_ptr += 8;
+      /* Fetch tile and draw it, 4 pixels at a time */
+      pattern = get_patpix(bg_offset + (tile_index << 4));
+      bmp_ptr[0] = bg_lut[col_high >> 2][pattern >> 8];
+      bmp_ptr[1] = bg_lut[col_high >> 2][pattern & 0xFF];
+      bmp_ptr += 2;
 
       x_tile++;
 
@@ -640,6 +781,9 @@ INLINE void ppu_renderbg(uint8 *vidbuf)
       }
    }
 
+   if (ppu.tile_xofs)
+      memcpy(vidbuf, (uint8 *) bg_line + ppu.tile_xofs, NES_SCREEN_WIDTH);
+
    /* Blank left hand column if need be */
    if (!ppu.left_bg_on)
    {
@@ -648,11 +792,56 @@ INLINE void ppu_renderbg(uint8 *vidbuf)
    }
 }
 
+/* Pattern address of the sprite row on this scanline, or -1 if out of range */
+INLINE int32 sprite_tile_addr(ppu_obj_t *sprite, int scanline)
+{
+   int32 sprite_height, y_offset, tile_addr, sprite_y;
+
+   sprite_y = sprite->y_loc + 1;
+   sprite_height = ppu.obj_height;
+
+   /* Check to see if sprite is out of range */
+   if ((sprite_y > scanline) || (sprite_y <= (scanline - sprite_height))
+       || (0 == sprite_y) || (sprite_y >= 240))
+      return -1;
+
+   /* Handle $FD/$FE tile VROM switching (PunchOut) */
+   if (ppu.latchfunc)
+      ppu.latchfunc(ppu.obj_base, sprite->tile);
+
+   /* 8x16 even sprites use $0000, odd use $1000 */
+   if (16 == sprite_height)
+      tile_addr = ((sprite->tile & 1) << 12) | ((sprite->tile & 0xFE) << 4);
+   else
+      tile_addr = ppu.obj_base + (sprite->tile << 4);
+
+   /* Calculate offset (line within the sprite) */
+   y_offset = scanline - sprite_y;
+   if (y_offset > 7)
+      y_offset += 8;
+
+   /* Account for vertical flippage */
+   if (sprite->attr & OAMF_VFLIP)
+   {
+      if (16 == sprite_height)
+         y_offset -= 23;
+      else
+         y_offset -= 7;
+
+      tile_addr -= y_offset;
+   }
+   else
+   {
+      tile_addr += y_offset;
+   }
+
+   return tile_addr;
+}
+
 /* TODO: fetch valid OAM a scanline before, like the Real Thing */
 INLINE void ppu_renderoam(uint8 *vidbuf, int scanline, bool draw)
 {
-   int32 sprite_num, sprite_offset, sprite_height, count;
-   int32 y_offset, tile_addr, sprite_y, savecol1, savecol2;
+   int32 sprite_num, count, tile_addr, savecol1, savecol2;
    ppu_obj_t *sprite;
 
    if (false == ppu.obj_on)
@@ -662,55 +851,18 @@ INLINE void ppu_renderoam(uint8 *vidbuf, int scanline, bool draw)
    savecol1 = ((int32 *) vidbuf)[0];
    savecol2 = ((int32 *) vidbuf)[1];
 
-   /* Sprite position */
-   sprite_height = ppu.obj_height;
-   sprite_offset = ppu.obj_base;
-
    sprite = (ppu_obj_t *) ppu.oam;
 
    for (sprite_num = 0, count = 0; sprite_num < 64; sprite_num++, sprite++)
    {
-      sprite_y = sprite->y_loc + 1;
-
-      /* Check to see if sprite is out of range */
-      if ((sprite_y > scanline) || (sprite_y <= (scanline - sprite_height))
-          || (0 == sprite_y) || (sprite_y >= 240))
+      tile_addr = sprite_tile_addr(sprite, scanline);
+      if (tile_addr < 0)
          continue;
 
-      /* Handle $FD/$FE tile VROM switching (PunchOut) */
-      if (ppu.latchfunc)
-         ppu.latchfunc(sprite_offset, sprite->tile);
-
-      /* 8x16 even sprites use $0000, odd use $1000 */
-      if (16 == sprite_height)
-         tile_addr = ((sprite->tile & 1) << 12) | ((sprite->tile & 0xFE) << 4);
-      else
-         tile_addr = sprite_offset + (sprite->tile << 4);
-
-      /* Calculate offset (line within the sprite) */
-      y_offset = scanline - sprite_y;
-      if (y_offset > 7)
-         y_offset += 8;
-
-      /* Account for vertical flippage */
-      if (sprite->attr & OAMF_VFLIP)
-      {
-         if (16 == sprite_height)
-            y_offset -= 23;
-         else
-            y_offset -= 7;
-
-         tile_addr -= y_offset;
-      }
-      else
-      {
-         tile_addr += y_offset;
-      }
-
       /* Check for a strike on sprite 0 if strike flag isn't set */
       if (sprite_num == 0 && false == ppu.strikeflag)
       {
-         check_strike(draw ? vidbuf + sprite->x_loc : NULL, sprite->attr, get_patpix(tile_addr));
+         check_strike(draw ? vidbuf + sprite->x_loc : NULL, sprite->x_loc, sprite->attr, get_patpix(tile_addr));
       }
 
       /* If we don't draw to buffer then we're done after sprite 0 */
@@ -737,6 +889,80 @@ INLINE void ppu_renderoam(uint8 *vidbuf, int scanline, bool draw)
    }
 }
 
+INLINE uint8 reverse_bits(uint8 b)
+{
+   b = ((b & 0xF0) >> 4) | ((b & 0x0F) << 4);
+   b = ((b & 0xCC) >> 2) | ((b & 0x33) << 2);
+   return ((b & 0xAA) >> 1) | ((b & 0x55) << 1);
+}
+
+/* Opaque pixels of a background tile on this scanline, 0 is the leftmost
+** tile fetched, as in ppu_renderbg()
+*/
+INLINE uint8 get_bgmask(int tile_num)
+{
+   int32 name_addr = 0x2000 + (ppu.vaddr & 0x0FE0);
+   int32 bg_offset = ((ppu.vaddr >> 12) & 7) + ppu.bg_base;
+   int x_tile = (ppu.vaddr & 0x1F) + tile_num;
+
+   if (x_tile & 32)
+      name_addr ^= (1 << 10); /* switch nametable */
+
+   return get_opaque(bg_offset + (PPU_MEM_READ(name_addr + (x_tile & 31)) << 4));
+}
+
+/* Skipped frames only need the sprite 0 strike and the sprite overflow flag,
+** which we get from the opaque masks without touching any pixels.
+*/
+INLINE void ppu_strikeline(int scanline)
+{
+   int32 sprite_num, count, tile_addr, bg_x;
+   uint8 obj_mask, bg_mask;
+   ppu_obj_t *sprite;
+
+   if (false == ppu.obj_on)
+      return;
+
+   sprite = (ppu_obj_t *) ppu.oam;
+
+   /* Check for a strike on sprite 0 if strike flag isn't set */
+   tile_addr = sprite_tile_addr(sprite, scanline);
+   if (tile_addr >= 0 && false == ppu.strikeflag && ppu.bg_on)
+   {
+      obj_mask = get_opaque(tile_addr);
+      if (sprite->attr & OAMF_HFLIP)
+         obj_mask = reverse_bits(obj_mask);
+
+      bg_x = sprite->x_loc + ppu.tile_xofs;
+      bg_mask = get_bgmask(bg_x >> 3) << (bg_x & 7);
+      if (bg_x & 7)
+         bg_mask |= get_bgmask((bg_x >> 3) + 1) >> (8 - (bg_x & 7));
+
+      bg_mask &= strike_mask(sprite->x_loc);
+
+      if (obj_mask & bg_mask)
+      {
+         /* 3 pixels per cpu cycle */
+         ppu.strike_cycle = nes6502_getcycles()
+                          + (__builtin_clz((uint32) (obj_mask & bg_mask) << 24) / 3);
+         ppu.strikeflag = true;
+      }
+   }
+
+   /* maximum of 8 sprites per scanline */
+   if (OPT(PPU_LIMIT_SPRITES))
+   {
+      for (sprite_num = 0, count = 0; sprite_num < 64; sprite_num++, sprite++)
+      {
+         if (sprite_tile_addr(sprite, scanline) >= 0 && ++count == PPU_MAXSPRITE)
+         {
+            ppu.stat |= PPU_STATF_MAXSPRITE;
+            break;
+         }
+      }
+   }
+}
+
 IRAM_ATTR bool ppu_enabled(void)
 {
    return (ppu.bg_on || ppu.obj_on);
@@ -803,11 +1029,18 @@ IRAM_ATTR void ppu_scanline(bitmap_t *bmp, int scanline, bool draw_flag)
       if (scanline == 0)
          ppu.left_bg_counter = 0;
 
-      if (draw_flag && OPT(PPU_DRAW_BACKGROUND))
-         ppu_renderbg(bmp->line[scanline]);
+      if (draw_flag)
+      {
+         if (OPT(PPU_DRAW_BACKGROUND))
+            ppu_renderbg(bmp->line[scanline]);
 
-      /* TODO: fetch obj data 1 scanline before */
-      ppu_renderoam(bmp->line[scanline], scanline, draw_flag && OPT(PPU_DRAW_SPRITES));
+         /* TODO: fetch obj data 1 scanline before */
+         ppu_renderoam(bmp->line[scanline], scanline, OPT(PPU_DRAW_SPRITES));
+      }
+      else
+      {
+         ppu_strikeline(scanline);
+      }
    }
    // Vertical Blank
    else if (scanline == 241)
@@ -839,6 +1072,15 @@ ppu_t *ppu_init(int region)
 {
    memset(&ppu, 0, sizeof(ppu_t));
 
+   for (int i = 0; i < 256; i++)
+   {
+      tile_spread[i] = 0;
+      for (int bit = 0; bit < 8; bit++)
+         tile_spread[i] |= ((i >> bit) & 1) << (bit * 2);
+   }
+
+   ppu_refresh();
+
    ppu_setopt(PPU_DRAW_BACKGROUND, true);
    ppu_setopt(PPU_DRAW_SPRITES, true);
    ppu_setopt(PPU_LIMIT_SPRITES, true);
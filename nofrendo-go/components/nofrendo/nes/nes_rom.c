@@ -179,6 +179,7 @@ rominfo_t *rom_load(const char *filename)
 {
    rominfo_t *rominfo;
    unsigned char *rom, *rom_ptr;
+   unsigned char header[sizeof(inesheader_t) + TRAINER_LENGTH];
    size_t filesize;
 
    rominfo = calloc(sizeof(rominfo_t), 1);
@@ -187,7 +188,13 @@ rominfo_t *rom_load(const char *filename)
 
    filesize = osd_getromdata(&rom);
    if (NULL == rom)
-      goto _fail;
+   {
+      /* Only the header is read now, the banks are paged in by the MMC */
+      if (!osd_readromdata(header, 0, MIN(filesize, sizeof(header))))
+         goto _fail;
+
+      rom = header;
+   }
 
    rom_ptr = rom;
 
@@ -203,6 +210,9 @@ rominfo_t *rom_load(const char *filename)
 	if (rom_getheader(&rom_ptr, rominfo))
       goto _fail;
 
+   if (rom == header)
+      rominfo->flags |= ROM_FLAG_PAGED;
+
    /* iNES format doesn't tell us if we need SRAM, so
    ** we have to always allocate it -- bleh!
    */
@@ -220,15 +230,25 @@ rominfo_t *rom_load(const char *filename)
       MESSAGE_INFO("Read in trainer at $7000\n");
    }
 
-   rominfo->rom = rom_ptr;
-   rom_ptr += ROM_BANK_LENGTH * rominfo->rom_banks;
+   rominfo->rom_offset = rom_ptr - rom;
+   rominfo->vrom_offset = rominfo->rom_offset + ROM_BANK_LENGTH * rominfo->rom_banks;
 
-   if (rominfo->vrom_banks)
+   if (rominfo->rom_offset + ROM_BANK_LENGTH * rominfo->rom_banks
+         + VROM_BANK_LENGTH * rominfo->vrom_banks > filesize)
    {
-      rominfo->vrom = rom_ptr;
-      rom_ptr += VROM_BANK_LENGTH * rominfo->vrom_banks;
+      MESSAGE_ERROR("ROM file is truncated\n");
+      goto _fail;
    }
-   else
+
+   if (!(rominfo->flags & ROM_FLAG_PAGED))
+   {
+      rominfo->rom = rom + rominfo->rom_offset;
+
+      if (rominfo->vrom_banks)
+         rominfo->vrom = rom + rominfo->vrom_offset;
+   }
+
+   if (0 == rominfo->vrom_banks)
    {
       rominfo->vram = calloc(VRAM_BANK_LENGTH, rominfo->vram_banks);
       if (NULL == rominfo->vram)
@@ -33,6 +33,7 @@
 #define  ROM_FLAG_TRAINER     0x02
 #define  ROM_FLAG_FOURSCREEN  0x04
 #define  ROM_FLAG_VERSUS      0x08
+#define  ROM_FLAG_PAGED       0x10
 
 #define  ROM_FOURSCREEN    0x08
 #define  ROM_TRAINER       0x04
@@ -67,9 +68,12 @@ typedef enum
 
 typedef struct rominfo_s
 {
-   /* pointers to ROM and VROM */
+   /* pointers to ROM and VROM, NULL if the banks are paged in by the MMC */
    uint8 *rom, *vrom;
 
+   /* offsets of ROM and VROM in the file */
+   size_t rom_offset, vrom_offset;
+
    /* pointers to SRAM and VRAM */
    uint8 *sram, *vram;
 
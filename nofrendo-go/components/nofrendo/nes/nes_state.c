@@ -215,15 +215,14 @@ int state_save(char* fn)
       /* TODO: snss spec should be updated, using 4kB ROM pages.. */
       for (i = 0; i < 4; i++)
       {
-         temp = swap16((mem_getpage((i + 4) * 4) - machine->rominfo->rom) >> 13);
+         temp = swap16(machine->mmc->prg_map[i + 4]);
          buffer[(i * 2) + 0] = ((uint8 *) &temp)[0];
          buffer[(i * 2) + 1] = ((uint8 *) &temp)[1];
       }
 
       for (i = 0; i < 8; i++)
       {
-         temp = (machine->rominfo->vrom_banks) ?
-            ((ppu_getpage(i) - machine->rominfo->vrom + (i * 0x400)) >> 10) : (i);
+         temp = (machine->rominfo->vrom_banks) ? machine->mmc->chr_map[i] : (i);
          temp = swap16(temp);
          buffer[8 + (i * 2) + 0] = ((uint8 *) &temp)[0];
          buffer[8 + (i * 2) + 1] = ((uint8 *) &temp)[1];
@@ -363,6 +362,7 @@ int state_load(char* fn)
          }
 
          _fread(machine->rominfo->vram, MIN(blockLength, 0x4000)); // Max 16K
+         ppu_refresh();
       }
 
 
@@ -405,6 +405,9 @@ int state_load(char* fn)
                ppu_setpage(1, i, machine->rominfo->vram);
          }
 
+         /* The mapper re-arms its timer from its state, if it has any */
+         nes_settimer(NULL, 0);
+
          if (machine->mmc->intf->set_state)
             machine->mmc->intf->set_state(buffer + 0x18);
       }
@@ -31,7 +31,7 @@
 
 /* video */
 extern void osd_setpalette(rgb_t *pal);
-extern void osd_blitscreen(bitmap_t *bmp);
+extern bool osd_blitscreen(bitmap_t *bmp);
 
 /* audio */
 extern void osd_audioframe(int nsamples);
@@ -49,8 +49,9 @@ extern char *osd_newextension(char *string, const char *ext);
 /* input */
 extern void osd_getinput(void);
 
-/* get rom data */
+/* get rom data, data is NULL when the rom has to be read with osd_readromdata */
 extern size_t osd_getromdata(unsigned char **data);
+extern bool osd_readromdata(void *buffer, size_t offset, size_t length);
 
 /* Log output */
 extern void osd_logprint(int type, char *message);
@@ -20,10 +20,12 @@
 
 static char* romData;
 static size_t romSize;
+static FILE* romFile;
 
-static uint16_t myPalette[64];
-static odroid_video_frame update1 = {NES_SCREEN_WIDTH, NES_SCREEN_HEIGHT, 0, 1, 0x3F, -1, NULL, myPalette, 0, {}};
-static odroid_video_frame update2 = {NES_SCREEN_WIDTH, NES_SCREEN_HEIGHT, 0, 1, 0x3F, -1, NULL, myPalette, 0, {}};
+static odroid_palette_t myPalette;
+static uint16_t palettes[2][64];
+static odroid_video_frame update1 = {NES_SCREEN_WIDTH, NES_SCREEN_HEIGHT, 0, 1, 0x3F, -1, NULL, palettes[0], 0, {}};
+static odroid_video_frame update2 = {NES_SCREEN_WIDTH, NES_SCREEN_HEIGHT, 0, 1, 0x3F, -1, NULL, palettes[1], 0, {}};
 static odroid_video_frame *currentUpdate = &update1;
 static odroid_video_frame *previousUpdate = NULL;
 
@@ -214,6 +216,19 @@ size_t osd_getromdata(unsigned char **data)
    return romSize;
 }
 
+bool osd_readromdata(void *buffer, size_t offset, size_t length)
+{
+   if (!romFile)
+      return false;
+
+   odroid_system_spi_lock_acquire(SPI_LOCK_SDCARD);
+   bool success = fseek(romFile, offset, SEEK_SET) == 0
+      && fread(buffer, length, 1, romFile) == 1;
+   odroid_system_spi_lock_release(SPI_LOCK_SDCARD);
+
+   return success;
+}
+
 void osd_loadstate()
 {
    if (odroid_system_get_start_action() == ODROID_START_ACTION_RESUME)
@@ -266,7 +281,7 @@ void osd_wait_for_vsync()
    // Tick before submitting audio/syncing
    odroid_system_tick(!nes->drawframe, fullFrame, elapsed);
 
-   nes->drawframe = (skipFrames == 0);
+   nes->drawframe = (skipFrames == 0) || odroid_movie_checkpoint_due(true);
 
    // Use audio to throttle emulation
    if (pendingSamples)
@@ -304,15 +319,15 @@ void osd_audioframe(int audioSamples)
 */
 void osd_setpalette(rgb_t *pal)
 {
+   /* Only the pixels using changed entries are redrawn */
    for (int i = 0; i < 64; i++)
    {
       uint16_t c = (pal[i].b>>3) + ((pal[i].g>>2)<<5) + ((pal[i].r>>3)<<11);
-      myPalette[i] = (c>>8) | ((c&0xff)<<8);
+      odroid_palette_set(&myPalette, i, c);
    }
-   odroid_display_force_refresh();
 }
 
-IRAM_ATTR void osd_blitscreen(bitmap_t *bmp)
+IRAM_ATTR bool osd_blitscreen(bitmap_t *bmp)
 {
    int crop_v = (overscan) ? nes->overscan : 0;
    int crop_l = (autocrop && nes->ppu->left_bg_counter > 210) ? 8 : 0;
@@ -323,10 +338,18 @@ IRAM_ATTR void osd_blitscreen(bitmap_t *bmp)
    currentUpdate->width  = bmp->width - (crop_l + crop_r);
    currentUpdate->height = bmp->height - (crop_v * 2);
 
-   fullFrame = odroid_display_queue_update(currentUpdate, previousUpdate) == SCREEN_UPDATE_FULL;
+   odroid_palette_latch(&myPalette, currentUpdate, 64);
+
+   short result = odroid_display_queue_update(currentUpdate, previousUpdate);
+   fullFrame = result == SCREEN_UPDATE_FULL;
+
+   // A dropped frame's bitmap is still ours, the next frame is drawn over it
+   if (result == SCREEN_UPDATE_DROPPED)
+      return false;
 
    previousUpdate = currentUpdate;
    currentUpdate = (currentUpdate == &update1) ? &update2 : &update1;
+   return true;
 }
 
 void osd_getinput(void)
@@ -342,7 +365,7 @@ void osd_getinput(void)
    static uint16 previous = 0xffff;
    uint16 b = 0, changed = 0;
 
-   odroid_input_gamepad_read(localJoystick);
+   odroid_input_gamepad_latch(localJoystick);
 
    if (localJoystick->values[ODROID_INPUT_MENU]) {
       odroid_overlay_game_menu();
@@ -395,20 +418,24 @@ void app_main(void)
    odroid_system_init(APP_ID, AUDIO_SAMPLE_RATE);
    odroid_system_emu_init(&LoadState, &SaveState, &netplay_callback);
 
-   romData = rg_alloc(0x200000, MEM_ANY);
-
    const char *romPath = odroid_system_get_rom_path();
 
    // Load ROM
    if (strcasecmp(romPath + (strlen(romPath) - 4), ".zip") == 0)
    {
       printf("app_main ROM: Reading compressed file: %s\n", romPath);
-      romSize = odroid_sdcard_unzip_file_to_memory(romPath, romData, 0x200000);
+      romData = rg_alloc(0x200000, MEM_ANY);
+      romSize = odroid_sdcard_unzip_file_to_memory(romPath, "nes", romData, 0x200000);
    }
    else
    {
-      printf("app_main ROM: Reading file: %s\n", romPath);
-      romSize = odroid_sdcard_copy_file_to_memory(romPath, romData, 0x200000);
+      // Plain files stay open, the mapper pages banks in as they are used
+      printf("app_main ROM: Opening file: %s\n", romPath);
+      romSize = odroid_sdcard_get_filesize(romPath);
+      odroid_system_spi_lock_acquire(SPI_LOCK_SDCARD);
+      romFile = fopen(romPath, "rb");
+      odroid_system_spi_lock_release(SPI_LOCK_SDCARD);
+      if (!romFile) romSize = 0;
    }
 
    printf("app_main ROM: romSize=%d\n", romSize);
@@ -88,7 +88,7 @@ void emulators_init_emu(retro_emulator_t *emu)
     DIR* dir = opendir(path);
     if (dir)
     {
-        char *selected_file = odroid_settings_RomFilePath_get();
+        const char *selected_file = odroid_settings_RomFilePath_get();
         struct dirent* in_file;
 
         while ((in_file = readdir(dir)))
@@ -129,7 +129,6 @@ void emulators_init_emu(retro_emulator_t *emu)
             }
         }
 
-        free(selected_file);
         closedir(dir);
     }
 
@@ -211,7 +211,11 @@ void retro_loop()
                     }
                     else if (sel == 2) {
                         if (odroid_overlay_confirm("Delete savestate?", false) == 1) {
-                            unlink(save_path);
+                            for (int slot = 0; slot < ODROID_STATE_SLOTS; slot++) {
+                                char *slot_path = odroid_system_get_path(ODROID_PATH_SAVE_STATE + slot, file->path);
+                                unlink(slot_path);
+                                free(slot_path);
+                            }
                         }
                     }
                     else if (sel == 3) {
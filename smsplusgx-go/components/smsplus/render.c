@@ -23,6 +23,7 @@
  ******************************************************************************/
 
 #include "shared.h"
+#include <odroid_system.h>
 
 //#include "sms_ntsc.h"
 
@@ -52,17 +53,18 @@ uint8 sms_cram_expand_table[4];
 uint8 gg_cram_expand_table[16];
 
 /* Dirty pattern info */
-//uint8 bg_name_dirty[0x200];     /* 1= This pattern is dirty */
-//uint16 bg_name_list[0x200];     /* List of modified pattern indices */
-//uint16 bg_list_index;           /* # of modified patterns in list */
+uint8 bg_name_dirty[0x200];     /* 1= This pattern is dirty */
+uint16 bg_name_list[0x200];     /* List of modified pattern indices */
+uint16 bg_list_index;           /* # of modified patterns in list */
 
 /* Internal buffer for drawing non 8-bit displays */
 static uint8 internal_buffer[0x200];
 
-/* Precalculated pixel table */
-static uint16 pixel[PALETTE_SIZE];
+/* Precalculated pixel table, only changed entries are converted */
+static odroid_palette_t pixel;
 
-//static uint8* bg_pattern_cache = ESP32_PSRAM + 0x300000; //[0x20000];/* Cached and flipped patterns */
+/* Cached and flipped patterns, tiles are decoded on the fly if it's NULL */
+static uint8 *bg_pattern_cache = NULL;  // [0x20000]
 
 
 static uint8 object_index_count;
@@ -328,6 +330,15 @@ void render_init(void)
   }
   bp_lut = _bp_lut;
 
+  /* The cache is read for every tile and sprite line, internal RAM is faster
+     but it's only used if enough of it is left for the tasks created later */
+  if (option.pattern_cache && !bg_pattern_cache)
+  {
+    bool internal = option.pattern_cache == 2
+      && heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL|MALLOC_CAP_8BIT) >= 0x20000 + 0x8000;
+    bg_pattern_cache = rg_alloc(0x20000, internal ? MEM_FAST : MEM_SLOW);
+  }
+
   sms_cram_expand_table[0] =  0;
   sms_cram_expand_table[1] = (5 << 3)  + (1 << 2);
   sms_cram_expand_table[2] = (15 << 3) + (1 << 2);
@@ -355,10 +366,11 @@ void render_reset(void)
   }
 
   /* Invalidate pattern cache */
-  //memset(bg_name_dirty, 0, sizeof(bg_name_dirty));
-  //memset(bg_name_list, 0, sizeof(bg_name_list));
-  //bg_list_index = 0;
-  //memset(bg_pattern_cache, 0, 0x20000 /*sizeof(bg_pattern_cache)*/);
+  memset(bg_name_dirty, 0, sizeof(bg_name_dirty));
+  memset(bg_name_list, 0, sizeof(bg_name_list));
+  bg_list_index = 0;
+  if (bg_pattern_cache)
+    memset(bg_pattern_cache, 0, 0x20000);
 
   /* Pick default render routine */
   if (vdp.reg[0] & 4)
@@ -584,40 +596,12 @@ IRAM_ATTR void render_bg_sms(int line)
     /* Expand priority and palette bits */
     atex_mask = atex[(attr >> 11) & 3];
 
-#if 0
     /* Point to a line of pattern data in cache */
-    cache_ptr = (uint32 *)&bg_pattern_cache[((attr & 0x7FF) << 6) | (v_row)];
-#else
-    // ---p cvhn nnnn nnnn
-
-    // uint8 data[8];
-    // uint16 name = attr & 0x1ff;
-    //
-    // uint16 y = line & 7;
-    // if (attr & 0x400)
-    // {
-    //     y = (y ^ 7);
-    // }
-    //
-    // uint16 bp01 = *(uint16 *)&vdp.vram[(name << 5) | (y << 2) | (0)];
-    // uint16 bp23 = *(uint16 *)&vdp.vram[(name << 5) | (y << 2) | (2)];
-    // uint32 temp = (bp_lut[bp01] >> 2) | (bp_lut[bp23]);
-    //
-    // uint8 rot = (attr >> (1 + 8)) & 0x03;
-    // for(short x = 0; x < 8; x++)
-    // {
-    //     uint8 c = (temp >> (x << 2)) & 0x0F;
-    //     short index = (attr & 0x2000) ? (x ^ 7) : x;
-    //     data[index] = (c);
-    //
-    //   //dst[0x08000 | (y << 3) | (x ^ 7)] = (c);
-    //   //dst[0x10000 | ((y ^ 7) << 3) | (x)] = (c);
-    //   //dst[0x18000 | ((y ^ 7) << 3) | (x ^ 7)] = (c);
-    // }
-
-    cache_ptr = tile_get(attr, v_row >> 3);
+    if (bg_pattern_cache)
+      cache_ptr = (uint32 *)&bg_pattern_cache[((attr & 0x7FF) << 6) | (v_row)];
+    else
+      cache_ptr = tile_get(attr, v_row >> 3);
 
-#endif
     /* Copy the left half, adding the attribute bits in */
     write_dword( &linebuf_ptr[(column << 1)] , read_dword( &cache_ptr[0] ) | (atex_mask));
 
@@ -641,17 +625,12 @@ IRAM_ATTR void render_bg_sms(int line)
 #endif
     a = (attr >> 7) & 0x30;
 
-    uint8* ptr = (uint8*)tile_get(attr, v_row >> 3);
+    uint8 *ptr = bg_pattern_cache ? &bg_pattern_cache[((attr & 0x7FF) << 6) | (v_row)]
+                                  : (uint8 *)tile_get(attr, v_row >> 3);
     for(x = 0; x < shift; x++)
     {
-#if 0
-      c = bg_pattern_cache[((attr & 0x7FF) << 6) | (v_row) | (x)];
+      c = ptr[x];
       p[x] = ((c) | (a));
-#else
-     c = *(ptr + x);
-     p[x] = ((c) | (a));
-#endif
-
     }
   }
 }
@@ -710,12 +689,11 @@ IRAM_ATTR void render_obj_sms(int line)
     /* Draw double size sprite */
     if(vdp.reg[1] & 0x01)
     {
-#if 0
       /* Retrieve tile data from cached nametable */
-      cache_ptr = (uint8 *)&bg_pattern_cache[(n << 6) | ((yp >> 1) << 3)];
-#else
-      cache_ptr = tile_get(n, yp >> 1);
-#endif
+      if (bg_pattern_cache)
+        cache_ptr = (uint8 *)&bg_pattern_cache[(n << 6) | ((yp >> 1) << 3)];
+      else
+        cache_ptr = tile_get(n, yp >> 1);
 
       /* Draw sprite line (at 1/2 dot rate) */
       for(x = start; x < end; x+=2)
@@ -744,12 +722,11 @@ IRAM_ATTR void render_obj_sms(int line)
     }
     else /* Regular size sprite (8x8 / 8x16) */
     {
-#if 0
       /* Retrieve tile data from cached nametable */
-      cache_ptr = (uint8 *)&bg_pattern_cache[(n << 6) | (yp << 3)];
-#else
-      cache_ptr = tile_get(n, yp);
-#endif
+      if (bg_pattern_cache)
+        cache_ptr = (uint8 *)&bg_pattern_cache[(n << 6) | (yp << 3)];
+      else
+        cache_ptr = tile_get(n, yp);
 
       /* Draw sprite line */
       for(x = start; x < end; x++)
@@ -840,8 +817,7 @@ void palette_sync(int index)
     }
   }
 
-  uint16 color = MAKE_PIXEL(r, g, b);
-  pixel[index] = (color >> 8) | (color << 8);
+  odroid_palette_set(&pixel, index, MAKE_PIXEL(r, g, b));
 }
 
 
@@ -914,14 +890,11 @@ static IRAM_ATTR void parse_satb(int line)
 
 static IRAM_ATTR void update_bg_pattern_cache(void)
 {
-#if 1
-    return;
-#else
   int i;
   uint8 x, y;
   uint16 name;
 
-  if(!bg_list_index) return;
+  if(!bg_list_index || !bg_pattern_cache) return;
 
   for(i = 0; i < bg_list_index; i++)
   {
@@ -951,7 +924,6 @@ static IRAM_ATTR void update_bg_pattern_cache(void)
     bg_name_dirty[name] = 0;
   }
   bg_list_index = 0;
-#endif
 }
 
 static inline void remap_8_to_16(int line)
@@ -966,14 +938,14 @@ static inline void remap_8_to_16(int line)
 
   for(i = 0; i < width; i++)
   {
-    p[i] = pixel[ internal_buffer[i] & PIXEL_MASK ];
+    p[i] = pixel.colors[ internal_buffer[i] & PIXEL_MASK ];
   }
  #else
     // //uint16* dst = p + bitmap.viewport.x;
     // uint8* src = internal_buffer + bitmap.viewport.x;
     //  for(int x = 0; x < bitmap.viewport.w; ++x)
     //  {
-    //    *(p++) = pixel[ *(src++) & PIXEL_MASK ];
+    //    *(p++) = pixel.colors[ *(src++) & PIXEL_MASK ];
     //  }
 
     uint8* dst = (uint8*)bitmap.data + (line * bitmap.pitch); // + bitmap.viewport.x;
@@ -987,7 +959,7 @@ static inline void remap_8_to_16(int line)
  #endif
 }
 
-void render_copy_palette(uint16* palette)
+void render_copy_palette(odroid_video_frame *frame)
 {
-    memcpy(palette, pixel, sizeof(pixel));
+    odroid_palette_latch(&pixel, frame, PALETTE_SIZE);
 }
@@ -36,9 +36,9 @@ extern void (*render_obj)(int line);
 extern uint8 *linebuf;
 extern uint8 sms_cram_expand_table[4];
 extern uint8 gg_cram_expand_table[16];
-//extern uint8 bg_name_dirty[0x200];
-//extern uint16 bg_name_list[0x200];
-//extern uint16 bg_list_index;
+extern uint8 bg_name_dirty[0x200];
+extern uint16 bg_name_list[0x200];
+extern uint16 bg_list_index;
 
 extern void render_shutdown(void);
 extern void render_init(void);
@@ -48,6 +48,6 @@ extern void render_line(int line);
 extern void render_bg_sms(int line);
 extern void render_obj_sms(int line);
 extern void palette_sync(int index);
-extern void render_copy_palette(uint16* palette);
+extern void render_copy_palette(odroid_video_frame *frame);
 
 #endif /* _RENDER_H_ */
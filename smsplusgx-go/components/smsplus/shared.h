@@ -19,6 +19,7 @@ typedef signed long int int32;
 #include <limits.h>
 //#include <zlib.h>
 #include <esp_attr.h>
+#include <odroid_display.h>
 
 #ifndef PATH_MAX
 #ifdef  MAX_PATH
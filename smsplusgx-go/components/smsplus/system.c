@@ -142,6 +142,7 @@ void system_reset_config()
   option.tms_pal      = 0;
   option.spritelimit  = 1;
   option.extra_gg     = 0;
+  option.pattern_cache = 1;
 }
 
 void system_init2(void)
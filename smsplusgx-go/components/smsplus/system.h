@@ -113,6 +113,7 @@ typedef struct
   uint8 use_bios;
   uint8 spritelimit;
   uint8 extra_gg;
+  uint8 pattern_cache;  /* 0: decode tiles on the fly, 1: cache in PSRAM, 2: cache in internal RAM */
 } option_t;
 
 /* Global variables */
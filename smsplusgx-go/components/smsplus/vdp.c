@@ -25,7 +25,6 @@
 #include "shared.h"
 #include "hvc.h"
 
-#if 0
 /* Mark a pattern as dirty */
 #define MARK_BG_DIRTY(addr)                         \
 {                                                   \
@@ -37,9 +36,6 @@
   }                                                 \
   bg_name_dirty[name] |= (1 << ((addr >> 2) & 7));  \
 }
-#else
-#define MARK_BG_DIRTY(addr)
-#endif
 
 /* VDP context */
 vdp_t vdp;
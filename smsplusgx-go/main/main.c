@@ -141,6 +141,7 @@ void app_main(void)
     option.sndrate = AUDIO_SAMPLE_RATE;
     option.overscan = 0;
     option.extra_gg = 0;
+    option.pattern_cache = odroid_settings_app_int32_get("PatternCache", 1);
 
     system_init2();
     system_reset();
@@ -174,7 +175,7 @@ void app_main(void)
 
     while (true)
     {
-        odroid_input_gamepad_read(localJoystick);
+        odroid_input_gamepad_latch(localJoystick);
 
         if (localJoystick->values[ODROID_INPUT_MENU]) {
             odroid_overlay_game_menu();
@@ -184,7 +185,7 @@ void app_main(void)
         }
 
         uint startTime = get_elapsed_time();
-        bool drawFrame = !skipFrames;
+        bool drawFrame = !skipFrames || odroid_movie_checkpoint_due(false);
 
         if (netplay)
         {
@@ -288,13 +289,17 @@ void app_main(void)
         {
             odroid_video_frame *previousUpdate = (currentUpdate == &update1) ? &update2 : &update1;
 
-            render_copy_palette(currentUpdate->palette);
+            render_copy_palette(currentUpdate);
 
-            fullFrame = odroid_display_queue_update(currentUpdate, previousUpdate) == SCREEN_UPDATE_FULL;
+            short result = odroid_display_queue_update(currentUpdate, previousUpdate);
+            fullFrame = result == SCREEN_UPDATE_FULL;
 
-            // Swap buffers
-            currentUpdate = previousUpdate;
-            bitmap.data = currentUpdate->buffer - bitmap.viewport.x;
+            // Swap buffers, unless the frame was dropped and we can draw over it
+            if (result != SCREEN_UPDATE_DROPPED)
+            {
+                currentUpdate = previousUpdate;
+                bitmap.data = currentUpdate->buffer - bitmap.viewport.x;
+            }
         }
 
         // See if we need to skip a frame to keep up